@@ -0,0 +1,350 @@
+// 后处理、NMS、跟踪和预处理热点函数的微基准, 输入为固定种子生成的合成张量和检测框
+// 每项输出 ns/op 和 allocs/op; allocs 统计 operator new 和 malloc/calloc/realloc 的调用次数,
+// 只包括本程序中编译的源文件, OpenCV 库内部的分配 (如 cv::Mat 的像素缓冲区) 不计入
+// post_process 需要 ./model/coco_80_labels_list.txt, 请在安装目录下运行, 找不到标签文件时跳过
+// 用法: kernel_bench [名称过滤] [每项最短测量时间 ms]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "postprocess.h"
+#include "preprocess.h"
+#include "ModelStages.h"
+#include "sort.h"
+#include "Hungarian.h"
+#include "KalmanTracker.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocs{0};
+
+} // namespace
+
+// 链接时用 -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc 把本程序和一起编译的源文件中的 malloc 调用转到这里,
+// 与 operator new 一起计数
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(p, size);
+}
+
+}
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = __real_malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+std::string g_filter;
+double g_minMs = 200.0;
+
+// 反复执行 op 直到超过最短测量时间, 每轮迭代次数翻倍; 先执行一次预热, 让复用的缓冲区分配到位
+template <typename F>
+void measure(const std::string& name, F&& op) {
+    if (!g_filter.empty() && name.find(g_filter) == std::string::npos) {
+        return;
+    }
+    op();
+    uint64_t iterations = 0;
+    uint64_t batch = 1;
+    const uint64_t allocStart = g_allocs.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed{0};
+    while (elapsed.count() < g_minMs) {
+        for (uint64_t i = 0; i < batch; ++i) {
+            op();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    const uint64_t allocs = g_allocs.load(std::memory_order_relaxed) - allocStart;
+    char line[192];
+    std::snprintf(line, sizeof(line), "%-52s %14.1f ns/op %10.2f allocs/op %10llu iters", name.c_str(),
+                  elapsed.count() * 1e6 / iterations, static_cast<double>(allocs) / iterations,
+                  static_cast<unsigned long long>(iterations));
+    std::cout << line << std::endl;
+}
+
+// 与 rknn 输出相同的仿射量化
+int8_t quantize(float value, int32_t zp, float scale) {
+    float q = value / scale + zp;
+    return static_cast<int8_t>(std::max(-128.0f, std::min(127.0f, std::round(q))));
+}
+
+// YOLOv5 三个检测头的 INT8 输出 [1, 3 * 85, H / stride, W / stride], 只有 candidates 个位置超过阈值
+struct YoloV5Outputs {
+    static constexpr int32_t kZp = -128;
+    static constexpr float kScale = 1.0f / 255.0f;
+
+    YoloV5Outputs(int inputW, int inputH, int candidates) {
+        std::mt19937 rng(candidates);
+        const int strides[3] = {8, 16, 32};
+        for (int s = 0; s < 3; ++s) {
+            grids[s] = cv::Size(inputW / strides[s], inputH / strides[s]);
+            tensors[s].assign(3 * PROP_BOX_SIZE * grids[s].area(), quantize(0.0f, kZp, kScale));
+        }
+        std::uniform_int_distribution<int> head(0, 2);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int n = 0; n < candidates; ++n) {
+            int s = head(rng);
+            const int gridLen = grids[s].area();
+            int a = n % 3;
+            int cell = static_cast<int>(unit(rng) * (gridLen - 1));
+            int8_t* base = tensors[s].data() + PROP_BOX_SIZE * a * gridLen + cell;
+            base[0] = quantize(unit(rng), kZp, kScale);
+            base[gridLen] = quantize(unit(rng), kZp, kScale);
+            base[2 * gridLen] = quantize(0.3f + 0.4f * unit(rng), kZp, kScale);
+            base[3 * gridLen] = quantize(0.3f + 0.4f * unit(rng), kZp, kScale);
+            base[4 * gridLen] = quantize(0.6f + 0.4f * unit(rng), kZp, kScale);
+            // 大部分是人, 少量其它类别, 覆盖按类别 NMS
+            int classId = n % 8 == 0 ? 1 + n % (OBJ_CLASS_NUM - 1) : 0;
+            base[(5 + classId) * gridLen] = quantize(0.6f + 0.4f * unit(rng), kZp, kScale);
+        }
+    }
+
+    cv::Size grids[3];
+    std::vector<int8_t> tensors[3];
+};
+
+// YOLOv8 风格浮点输出 [1, 4 + classes, boxes], 只有 candidates 个候选框超过阈值
+std::vector<float> makeYoloBoxOutput(int classes, int boxes, int candidates, const cv::Size& inputSize) {
+    std::mt19937 rng(candidates);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> data((4 + classes) * boxes, 0.0f);
+    for (int i = 0; i < boxes; ++i) {
+        data[i] = unit(rng) * inputSize.width;
+        data[boxes + i] = unit(rng) * inputSize.height;
+        data[2 * boxes + i] = 20.0f + unit(rng) * 100.0f;
+        data[3 * boxes + i] = 40.0f + unit(rng) * 150.0f;
+        for (int c = 0; c < classes; ++c) {
+            data[(4 + c) * boxes + i] = unit(rng) * 0.3f;
+        }
+    }
+    // 候选框在 10 个目标附近聚集, NMS 有实际的重叠框需要抑制
+    for (int n = 0; n < candidates && n < boxes; ++n) {
+        int i = static_cast<int>(static_cast<int64_t>(n) * boxes / std::max(candidates, 1));
+        int target = n % 10;
+        data[i] = 50.0f + target * 55.0f + unit(rng) * 8.0f;
+        data[boxes + i] = 100.0f + target * 40.0f + unit(rng) * 8.0f;
+        data[2 * boxes + i] = 50.0f + unit(rng) * 6.0f;
+        data[3 * boxes + i] = 120.0f + unit(rng) * 6.0f;
+        data[(4 + n % classes) * boxes + i] = 0.6f + 0.4f * unit(rng);
+    }
+    return data;
+}
+
+struct BenchDetection {
+    int id;
+    float confidence;
+    cv::Rect_<float> box;
+};
+
+struct BenchResult {
+    std::vector<BenchDetection> detections;
+};
+
+// 在画面中均匀分布的目标, 每帧小幅移动, 轨迹保持稳定
+std::vector<DetectionBox> makeDetections(int count, int frame) {
+    std::vector<DetectionBox> dets;
+    dets.reserve(count);
+    const int cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(count * 16.0 / 9.0))));
+    for (int i = 0; i < count; ++i) {
+        DetectionBox det;
+        det.score = 0.9f;
+        float x = 20.0f + (i % cols) * (1880.0f / cols) + 5.0f * std::sin(frame * 0.1f + i);
+        float y = 20.0f + (i / cols) * 90.0f + 3.0f * std::cos(frame * 0.1f + i);
+        det.box = cv::Rect_<float>(x, y, 40.0f, 80.0f);
+        dets.push_back(det);
+    }
+    return dets;
+}
+
+void benchPostProcess() {
+    if (initPostProcess() < 0) {
+        std::cout << "post_process: skipped, labels not found (run from the install directory)" << std::endl;
+        return;
+    }
+    for (int candidates : {0, 10, 100, 1000}) {
+        YoloV5Outputs outputs(640, 640, candidates);
+        std::vector<int32_t> zps(3, YoloV5Outputs::kZp);
+        std::vector<float> scales(3, YoloV5Outputs::kScale);
+        detect_result_group_t group;
+        BOX_RECT pads{};
+        // candidates=0 时只有三个检测头的逐格扫描 (process), 其余为扫描加排序和 NMS
+        measure("post_process 640x640 candidates=" + std::to_string(candidates), [&] {
+            post_process(outputs.tensors[0].data(), outputs.tensors[1].data(), outputs.tensors[2].data(), 640, 640,
+                         BOX_THRESH, NMS_THRESH, pads, 640.0f / 1920, 640.0f / 1080, zps, scales, &group);
+        });
+    }
+}
+
+void benchYoloBoxDecoder() {
+    const cv::Size inputSize(640, 640);
+    const int boxes = 8400;
+    const int classes = 2;
+    for (int candidates : {0, 10, 100, 1000}) {
+        std::vector<float> data = makeYoloBoxOutput(classes, boxes, candidates, inputSize);
+        rknn_tensor_attr attr{};
+        attr.n_dims = 3;
+        attr.dims[0] = 1;
+        attr.dims[1] = 4 + classes;
+        attr.dims[2] = boxes;
+        rknn_output output{};
+        output.buf = data.data();
+        FrameContext frame;
+        frame.inputSize = inputSize;
+        frame.srcSize = cv::Size(1920, 1080);
+        frame.boxThreshold = 0.5f;
+        frame.nmsThreshold = 0.45f;
+        YoloBoxDecoder<BenchResult> decoder;
+        decoder.init(&attr, 1, frame);
+        BenchResult result;
+        measure("YoloBoxDecoder::decode [1," + std::to_string(4 + classes) + ",8400] candidates=" +
+                    std::to_string(candidates), [&] {
+            decoder.decode(&output, frame, result);
+        });
+    }
+}
+
+void benchPreprocess() {
+    const cv::Size target(640, 640);
+    for (cv::Size source : {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)}) {
+        cv::Mat image(source, CV_8UC3);
+        cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+        const std::string resolution = std::to_string(source.width) + "x" + std::to_string(source.height);
+
+        float scale = std::min(static_cast<float>(target.width) / source.width,
+                               static_cast<float>(target.height) / source.height);
+        cv::Mat padded;
+        BOX_RECT pads{};
+        measure("letterbox " + resolution + " -> 640x640", [&] {
+            letterbox(image, padded, pads, scale, target);
+        });
+
+        ResizePreprocessor resize;
+        resize.init(target);
+        FrameContext frame;
+        measure("ResizePreprocessor::run " + resolution + " -> 640x640", [&] {
+            resize.run(image, frame);
+        });
+    }
+}
+
+void benchSort() {
+    for (int tracks : {1, 10, 50, 100}) {
+        TrackingSession* session = CreateSession(2, 3, 0.01f);
+        std::vector<std::vector<DetectionBox>> frames;
+        // 预先生成一个周期的检测, 循环送入, 生成不计入测量
+        for (int f = 0; f < 63; ++f) {
+            frames.push_back(makeDetections(tracks, f));
+        }
+        size_t frameIdx = 0;
+        measure("Sort::Update tracks=" + std::to_string(tracks), [&] {
+            session->Update(frames[frameIdx]);
+            frameIdx = (frameIdx + 1) % frames.size();
+        });
+        ReleaseSession(&session);
+    }
+}
+
+void benchHungarian() {
+    for (int n : {5, 20, 50, 100}) {
+        std::mt19937 rng(n);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<std::vector<double>> cost(n, std::vector<double>(n));
+        for (auto& row : cost) {
+            for (double& value : row) {
+                value = 1.0 - unit(rng);
+            }
+        }
+        HungarianAlgorithm solver;
+        std::vector<int> assignment;
+        measure("HungarianAlgorithm::Solve " + std::to_string(n) + "x" + std::to_string(n), [&] {
+            solver.Solve(cost, assignment);
+        });
+    }
+}
+
+void benchKalmanPredict() {
+    for (int tracks : {10, 100}) {
+        std::vector<DetectionBox> dets = makeDetections(tracks, 0);
+        std::vector<KalmanTracker> trackers;
+        trackers.reserve(tracks);
+        for (const auto& det : dets) {
+            trackers.emplace_back(det.box);
+        }
+        size_t idx = 0;
+        // 每次调用预测一条轨迹, 依次轮转; 不调用 Update, 历史框按 vector 倍增增长
+        measure("KalmanTracker::Predict tracks=" + std::to_string(tracks), [&] {
+            trackers[idx].Predict();
+            idx = (idx + 1) % trackers.size();
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    g_filter = argc > 1 ? argv[1] : "";
+    g_minMs = argc > 2 ? std::atof(argv[2]) : 200.0;
+    std::cout << "min time per benchmark: " << g_minMs << " ms" << std::endl;
+
+    benchPostProcess();
+    benchYoloBoxDecoder();
+    benchPreprocess();
+    benchSort();
+    benchHungarian();
+    benchKalmanPredict();
+
+    deinitPostProcess();
+    return 0;
+}
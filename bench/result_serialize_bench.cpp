@@ -0,0 +1,98 @@
+// 单帧结果序列化耗时对比
+// 用法: result_serialize_bench [帧数] [每帧人数]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <json/json.h>
+#include "ResultSerializer.h"
+
+namespace {
+
+// 构造一帧与 resultProcessingThread 输出结构相同的结果
+Json::Value makeFrame(uint64_t frameID, int persons) {
+    Json::Value root;
+    root["frameID"] = static_cast<Json::UInt64>(frameID);
+    Json::Value perDetJson;
+    Json::Value perAttrJson;
+    for (int i = 0; i < persons; ++i) {
+        Json::Value det;
+        det["id"] = i + 1;
+        det["x"] = 578.4610595703125 + i * 13.7;
+        det["y"] = 373.16336059570312 + i * 3.1;
+        det["width"] = 44.384883880615234;
+        det["height"] = 80.156204223632812;
+        perDetJson.append(det);
+
+        Json::Value attr;
+        attr["id"] = i + 1;
+        for (int a = 0; a < 26; ++a) {
+            attr["attr" + std::to_string(a)] = (i + a) % 3 == 0;
+        }
+        perAttrJson.append(attr);
+    }
+    root["personDetections"] = perDetJson;
+    root["perAttrDetections"] = perAttrJson;
+    root["RegionCoun"] = persons / 2;
+    root["zoneCounts"]["region0"] = persons / 2;
+    root["lineCrossings"]["line0"]["forward"] = 12;
+    root["lineCrossings"]["line0"]["backward"] = 7;
+    return root;
+}
+
+template <typename F>
+double measure(const char* name, int frames, const Json::Value& frame, F&& fn) {
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        bytes += fn(frame);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    double perFrame = elapsed.count() / frames;
+    std::cout << name << ": " << perFrame << " us/frame, " << bytes / frames << " bytes/frame" << std::endl;
+    return perFrame;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int persons = argc > 2 ? std::atoi(argv[2]) : 20;
+    Json::Value frame = makeFrame(60, persons);
+    std::cout << "frames=" << frames << " persons=" << persons << std::endl;
+
+    // 原流程: 子树各自格式化写文件, 整帧再格式化两次 (结果文件和数据库)
+    measure("styled (per-model + file + db)", frames, frame, [](const Json::Value& root) {
+        size_t bytes = root["personDetections"].toStyledString().size();
+        bytes += root["perAttrDetections"].toStyledString().size();
+        bytes += root.toStyledString().size();
+        bytes += root.toStyledString().size();
+        return bytes;
+    });
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    measure("jsoncpp StreamWriter compact (whole frame)", frames, frame, [&builder](const Json::Value& root) {
+        return Json::writeString(builder, root).size();
+    });
+
+    ResultSerializer json(ResultEncoding::Json);
+    measure("ResultSerializer json (per-model + frame)", frames, frame, [&json](const Json::Value& root) {
+        json.reset();
+        size_t bytes = json.add("personDetections", root["personDetections"]).size();
+        bytes += json.add("perAttrDetections", root["perAttrDetections"]).size();
+        bytes += json.finish(root)->size();
+        return bytes;
+    });
+
+    ResultSerializer msgpack(ResultEncoding::MsgPack);
+    measure("ResultSerializer msgpack (per-model + frame)", frames, frame, [&msgpack](const Json::Value& root) {
+        msgpack.reset();
+        size_t bytes = msgpack.add("personDetections", root["personDetections"]).size();
+        bytes += msgpack.add("perAttrDetections", root["perAttrDetections"]).size();
+        bytes += msgpack.finish(root)->size();
+        return bytes;
+    });
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef APPCONFIG_H
+#define APPCONFIG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "ZoneEngine.h"
+#include "LineCounter.h"
+
+// 单个模型池的配置
+struct ModelConfig {
+    std::string name;            // 配置中的键名, 如 perdet
+    std::string path;            // 模型文件, 相对路径相对于模型目录
+    int instances = 1;           // 模型池实例数
+    cv::Size inputSize;          // 期望的模型输入尺寸, 与模型文件不符时初始化失败; 0x0 表示不检查
+    float boxThreshold = 0.5f;   // 检测框置信度阈值
+    float nmsThreshold = 0.5f;   // NMS 阈值
+    bool pipelined = false;      // 流水线推理: 当前帧在 NPU 上运行时处理前后帧, 结果晚一帧发布
+};
+
+// 人员跟踪 (SORT) 参数
+struct TrackerConfig {
+    int maxAge = 2;              // 轨迹连续丢失多少帧后删除
+    int minHits = 3;             // 轨迹连续命中多少帧后输出
+    float iouThreshold = 0.01f;  // 关联的最小 IoU
+    float lowThreshold = 0.1f;   // 二次关联的低分检测阈值, <= 0 关闭二次关联
+    float lowIou = 0.3f;         // 二次关联的 IoU 阈值
+};
+
+// 单路视频流的配置
+struct StreamConfig {
+    std::string source;                  // 视频源, 为空时匹配任意视频源
+    cv::Size frameSize{1920, 1080};      // 视频尺寸, 用于模型预热和热力图在打开视频前的预分配
+    int sampleIntervalMs = 1000;         // 送入推理的采样间隔
+    int64_t loiterMs = 60000;            // 区域停留超过该时长产生徘徊事件
+    std::vector<Zone> zones;             // 区域计数多边形, 第一个区域同时输出为 RegionCoun
+    std::vector<CountLine> lines;        // 越线计数线段
+};
+
+// 运行配置, 通过 --config 从 JSON 文件加载, 文件中未出现的项保持默认值
+// 默认值与原先编译进程序的值一致, 不带 --config 时行为不变
+class AppConfig {
+public:
+    AppConfig();
+
+    // 加载配置文件, 格式错误或取值非法时返回 -1, 此时配置保持加载前的状态
+    int load(const std::string& path);
+
+    // 返回与视频源匹配的流配置, 没有匹配项时返回第一路
+    const StreamConfig& streamFor(const std::string& source) const;
+
+    // 返回模型文件的完整路径
+    std::string modelFile(const ModelConfig& model) const;
+
+    // 生效配置的文本描述, 启动时打印
+    std::string summary() const;
+
+    std::string sourcePath;              // 配置文件路径, 为空表示使用默认值
+    std::string modelDir;                // 模型目录, 默认是可执行文件所在目录下的 model/
+    size_t queueLength = 1000;           // 帧队列和结果队列长度
+    ModelConfig perDet, perAttr, fallDet, fireSmokeDet;
+    TrackerConfig tracker;
+    std::vector<StreamConfig> streams;
+};
+
+#endif // APPCONFIG_H
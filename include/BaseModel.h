@@ -1,11 +1,26 @@
 #ifndef BASEMODEL_H
 #define BASEMODEL_H
 
+#include <chrono>
+#include <cstring>
 #include <string>
 #include <mutex>
+#include <iostream>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include "rknn_api.h"
 #include <condition_variable>
+#include "ModelBlob.h"
+
+// 模型初始化分段耗时 (毫秒)
+struct ModelInitTiming {
+    double loadMs = 0;        // 映射模型文件
+    double initMs = 0;        // rknn_init 或 rknn_dup_context
+    double totalMs = 0;       // 整个 init, 其余部分为属性查询和后处理准备
+    bool shared = false;      // 是否与同池的首个实例共享权重
+    double warmupFirstMs = 0;     // 预热第一次推理 (冷启动)
+    double warmupSteadyMs = 0;    // 预热其余推理的平均值 (稳态)
+};
 
 template <typename ResultType>
 class BaseModel {
@@ -16,12 +31,52 @@ public:
 
     virtual ~BaseModel() = default;
 
-    // 初始化模型
-    virtual int init(const std::string& modelPath) = 0;
+    // 初始化模型, shareFrom 为同一模型已初始化的上下文时与其共享权重
+    virtual int init(const std::string& modelPath, rknn_context* shareFrom = nullptr) = 0;
 
     // 获取 RKNN context
     virtual rknn_context* get_rknn_context() = 0;
 
+    const ModelInitTiming& initTiming() const { return initTiming_; }
+
+    // 设置检测阈值, 需在 init 之前调用
+    void setThresholds(float boxConfThreshold, float nmsThreshold) {
+        box_conf_threshold_ = boxConfThreshold;
+        nms_threshold_ = nmsThreshold;
+    }
+
+    // 流水线推理: infer 提交当前帧后立即返回, 发布的是同一实例上一帧的结果, 需在 init 之前设置
+    void setPipelined(bool pipelined) { pipelined_ = pipelined; }
+    bool pipelined() const { return pipelined_; }
+
+    // 流水线模式下完成仍在 NPU 上的一帧并发布其结果, 没有进行中的帧时直接返回 0
+    // 该帧推理失败时返回 -1, 同样会发布空结果
+    virtual int flush() { return 0; }
+
+    // 模型输入尺寸, init 之后有效
+    cv::Size inputSize() const { return cv::Size(width_, height_); }
+
+    // 预热: 用合成输入连续推理 iterations 次, 让运行时和后处理完成惰性分配, 结果不对外发布
+    // latencies 返回每次推理的耗时 (毫秒)
+    int warmup(const cv::Mat& input, int iterations, std::vector<double>& latencies) {
+        int ret = 0;
+        warmingUp_ = true;
+        for (int i = 0; i < iterations && ret == 0; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            ret = infer(input);
+            latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        if (flush() < 0) {
+            ret = -1;
+        }
+        warmingUp_ = false;
+        {
+            std::lock_guard<std::mutex> lock(resultMtx_);
+            dataReady_ = false;
+        }
+        return ret;
+    }
+
     // 推理函数
     virtual int infer(const cv::Mat& inputData) = 0;
 
@@ -37,17 +92,64 @@ public:
     }
 
 protected:
+    // 创建 RKNN 上下文
+    // 优先用 rknn_dup_context 复制 shareFrom, 其次用 RKNN_FLAG_SHARE_WEIGHT_MEM 共享权重初始化,
+    // 都不可用时从共享的模型文件映射完整初始化; 映射只在初始化期间持有
+    int createContext(const std::string& modelPath, rknn_context* shareFrom) {
+        using Clock = std::chrono::steady_clock;
+        int ret = -1;
+        initTiming_ = ModelInitTiming();
+        auto start = Clock::now();
+        if (shareFrom && *shareFrom) {
+            ret = rknn_dup_context(shareFrom, &ctx_);
+            if (ret == RKNN_SUCC) {
+                initTiming_.shared = true;
+                initTiming_.initMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                return 0;
+            }
+            std::cerr << "rknn_dup_context failed with error code: " << ret << ", initializing from model file" << std::endl;
+        }
+
+        start = Clock::now();
+        std::shared_ptr<const ModelBlob> blob = ModelBlob::open(modelPath);
+        initTiming_.loadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (!blob) {
+            std::cerr << "Failed to load model data from: " << modelPath << std::endl;
+            return -1;
+        }
+        start = Clock::now();
+        if (shareFrom && *shareFrom) {
+            rknn_init_extend extend;
+            memset(&extend, 0, sizeof(extend));
+            extend.ctx = *shareFrom;
+            ret = rknn_init(&ctx_, blob->data(), static_cast<uint32_t>(blob->size()), RKNN_FLAG_SHARE_WEIGHT_MEM, &extend);
+            initTiming_.shared = ret == RKNN_SUCC;
+        }
+        if (!initTiming_.shared) {
+            ret = rknn_init(&ctx_, blob->data(), static_cast<uint32_t>(blob->size()), 0, nullptr);
+        }
+        initTiming_.initMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ret < 0) {
+            std::cerr << "rknn_init failed with error code: " << ret << std::endl;
+            ctx_ = 0;
+            return -1;
+        }
+        return 0;
+    }
+
+    ModelInitTiming initTiming_;                      // 最近一次 init 的分段耗时
+    bool warmingUp_ = false;                          // 预热中, 推理不更新跨帧状态 (如跟踪)
+    bool pipelined_ = false;                          // 流水线推理模式
     cv::Mat inputData_;                               // 输入数据
     std::string modelPath_;                           // 模型路径
-    unsigned char *model_data_;                       // 模型数据
-    int channel_, width_, height_;                       // 输入通道、宽度和高度
+    int channel_ = 0, width_ = 0, height_ = 0;           // 输入通道、宽度和高度
     int img_width_, img_height_;                        // 图像宽度和高度
-    rknn_context ctx_;                                // RKNN上下文
+    rknn_context ctx_ = 0;                            // RKNN上下文
     rknn_input_output_num io_num_;                    // 输入输出数量
-    rknn_tensor_attr *input_attrs_;                   // 输入张量属性
-    rknn_tensor_attr *output_attrs_;                  // 输出张量属性
+    rknn_tensor_attr *input_attrs_ = nullptr;         // 输入张量属性
+    rknn_tensor_attr *output_attrs_ = nullptr;        // 输出张量属性
     rknn_input inputs_[1];                            // 输入数组
-    float nms_threshold_, box_conf_threshold_;        // NMS阈值和置信度阈值
+    float nms_threshold_ = 0.5f, box_conf_threshold_ = 0.5f;  // NMS阈值和置信度阈值
     std::function<void(ResultType)> callback_;        // 存储回调函数
 };
 
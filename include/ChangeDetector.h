@@ -0,0 +1,76 @@
+#ifndef CHANGEDETECTOR_H
+#define CHANGEDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include "TrackStateMap.h"
+
+// 检测状态变化判定: 位于汇总后的帧结果与各输出端之间, 只有状态发生有意义的变化
+// (新目标、目标丢失、区域计数变化、跌倒/火焰/烟雾出现或消失) 或到达关键帧间隔时才需要持久化
+class ChangeDetector {
+public:
+    enum Change : uint32_t {
+        NewTrack   = 1u << 0,
+        TrackLost  = 1u << 1,
+        ZoneCount  = 1u << 2,
+        FallOnset  = 1u << 3,
+        FallClear  = 1u << 4,
+        FireOnset  = 1u << 5,
+        FireClear  = 1u << 6,
+        SmokeOnset = 1u << 7,
+        SmokeClear = 1u << 8,
+        Keyframe   = 1u << 9
+    };
+
+    enum Hazard { Fall, Fire, Smoke, HazardCount };
+
+    // keyframeIntervalMs: 无变化时最长多久强制持久化一次, 0 表示不输出关键帧
+    // lostFrames / clearFrames: 目标连续缺失多少帧视为丢失, 危险目标连续多少帧未检出视为消失
+    explicit ChangeDetector(int64_t keyframeIntervalMs = 60000, int lostFrames = 5, int clearFrames = 5,
+                            size_t maxTracks = 1024);
+
+    void setKeyframeInterval(int64_t keyframeIntervalMs) { keyframeIntervalMs_ = keyframeIntervalMs; }
+
+    // 开始一帧, 之后只需调用本帧有结果的模型对应的 update 接口
+    void beginFrame();
+
+    // 本帧人检测输出的跟踪 ID
+    void updateTracks(const std::vector<int>& trackIds);
+
+    // 本帧各区域计数
+    void updateZones(const std::vector<int>& zoneCounts);
+
+    // 本帧是否检出危险目标
+    void updateHazard(Hazard hazard, bool present);
+
+    // 结束一帧, 返回本帧的变化标志; 非 0 表示需要持久化
+    uint32_t endFrame(int64_t nowMs);
+
+    // 变化标志对应的名称, 用于结果 JSON
+    static void names(uint32_t changes, std::vector<const char*>& out);
+
+private:
+    struct TrackState {
+        uint64_t lastSeenFrame = 0;
+    };
+
+    struct HazardState {
+        bool active = false;
+        int absentFrames = 0;
+    };
+
+    int64_t keyframeIntervalMs_;
+    int lostFrames_;
+    int clearFrames_;
+
+    TrackStateMap<TrackState> tracks_;
+    bool tracksUpdated_ = false;
+    std::vector<int> zoneCounts_;
+    HazardState hazards_[HazardCount];
+
+    uint64_t trackFrame_ = 0;      // 有人检测结果的帧数
+    uint32_t changes_ = 0;
+    int64_t lastPersistMs_ = -1;
+};
+
+#endif // CHANGEDETECTOR_H
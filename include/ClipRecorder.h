@@ -0,0 +1,101 @@
+#ifndef CLIPRECORDER_H
+#define CLIPRECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// 事件前后视频片段录制
+// 采集线程送入的帧在后台线程中编码为 JPEG 并保存在按时长和字节数限制的环形缓冲中,
+// 事件触发时把事件前 preMs 到事件后 postMs 的已编码帧直接封装为 MJPEG AVI, 不需要重新解码或编码.
+// 事件由汇总线程在推理之后触发, 比采集晚; 环形缓冲额外保留 lagMs, 观察到更大的延迟时自动放宽
+class ClipRecorder {
+public:
+    ClipRecorder(const std::string& dir = "output/clips", int64_t preMs = 5000, int64_t postMs = 5000,
+                 double maxFps = 10.0, size_t maxRingBytes = 64 << 20, int jpegQuality = 80, int64_t lagMs = 3000);
+
+    // 写完未完成的片段后退出
+    ~ClipRecorder();
+
+    // 片段所在目录由 dirFor 按事件时间给出 (如 StorageManager 的小时分片), 未设置时写在 dir 下; 需在 start 之前调用
+    void setDirectoryProvider(std::function<std::string(int64_t timestampMs)> dirFor) { dirFor_ = std::move(dirFor); }
+
+    void start();
+    void stop();
+    bool running() const { return running_; }
+
+    // 采集线程调用, 超过 maxFps 的帧直接丢弃, 接受的帧会被复制
+    void pushFrame(const cv::Mat& frame, int64_t timestampMs);
+
+    // 触发一次事件, 与正在录制的片段重叠时延长该片段
+    void trigger(const std::string& reason, int64_t eventMs);
+
+private:
+    struct EncodedFrame {
+        int64_t timestampMs;
+        std::shared_ptr<const std::vector<uchar>> jpeg;
+    };
+
+    struct Clip {
+        std::string reason;
+        int64_t eventMs;
+        int64_t endMs;
+        int width;
+        int height;
+        std::vector<EncodedFrame> frames;
+    };
+
+    struct Event {
+        std::string reason;
+        int64_t eventMs;
+    };
+
+    void encodeLoop();
+    void writeLoop();
+    void finishClip();
+    void writeClip(const Clip& clip);
+
+    std::string dir_;
+    std::function<std::string(int64_t)> dirFor_;
+    int64_t preMs_;
+    int64_t postMs_;
+    int64_t minIntervalMs_;
+    size_t maxRingBytes_;
+    std::vector<int> params_;
+
+    std::atomic<bool> running_{false};
+    int64_t lastAcceptedMs_ = 0;      // 只在采集线程中访问
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool quit_ = false;
+    cv::Mat pendingFrame_;            // 待编码的帧, 编码跟不上时只保留最新一帧
+    int64_t pendingMs_ = 0;
+    std::vector<Event> events_;
+
+    // 以下只在编码线程中访问
+    std::deque<EncodedFrame> ring_;
+    size_t ringBytes_ = 0;
+    int64_t lagMs_;                   // 事件相对最新采集帧的最大延迟, 环形缓冲保留 preMs_ + lagMs_
+    int width_ = 0;
+    int height_ = 0;
+    std::unique_ptr<Clip> active_;
+
+    std::mutex writeMtx_;
+    std::condition_variable writeCv_;
+    std::deque<std::unique_ptr<Clip>> finished_;
+    bool writeQuit_ = false;
+
+    std::thread encodeThread_;
+    std::thread writeThread_;
+};
+
+#endif // CLIPRECORDER_H
@@ -1,68 +1,142 @@
+#ifndef DATABASEMANAGER_H
+#define DATABASEMANAGER_H
+
 #include <sqlite3.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <json/json.h>  // 用于JSON的操作
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "DetectionLog.h"
 
 // 数据库操作类
+// 进程内只保留一个长连接, 所有写入先进入队列, 由后台写线程使用预编译语句批量提交,
+// 调用线程不会阻塞在磁盘 I/O 上
+// 除原始 JSON 外, 每帧结果还拆分写入 frames / detections / zone_counts / tracks 表,
+// 并在写入时增量维护按分钟和小时汇总的 rollup_minute / rollup_hour 表
 class DatabaseManager {
 public:
-    DatabaseManager(const std::string& dbName) {
-        // 打开或创建数据库
-        if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
-            std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
-        }
-        // else {
-        //     std::cout << "Opened database successfully." << std::endl;
-        // }
-        createTable();
-    }
-
-    ~DatabaseManager() {
-        // 关闭数据库
-        sqlite3_close(db);
-        // std::cout << "closed database successfully." << std::endl;
-    }
+    // batchSize 条或 flushIntervalMs 毫秒提交一次事务, 待写入超过 maxPending 条时丢弃最旧的记录
+    explicit DatabaseManager(const std::string& dbName, size_t batchSize = 64, int flushIntervalMs = 1000,
+                             size_t maxPending = 4096);
 
-    // 创建表
-    void createTable() {
-        const char* createTableSQL = R"(
-            CREATE TABLE IF NOT EXISTS rtsp_logs (
-                timestamp TEXT,
-                ip_address TEXT,
-                rtsp_url TEXT,
-                data TEXT,
-                PRIMARY KEY (ip_address, timestamp)
-            );
-        )";
-
-        char* errorMessage = nullptr;
-        if (sqlite3_exec(db, createTableSQL, nullptr, nullptr, &errorMessage) != SQLITE_OK) {
-            std::cerr << "SQL Error: " << errorMessage << std::endl;
-            sqlite3_free(errorMessage);
-        }
-        // else {
-        //     std::cout << "Table created successfully or already exists." << std::endl;
-        // }
-    }
-
-    // 插入数据
-    void insertLog(const std::string& timestamp, const std::string& ip_address, const std::string& rtsp_url, const Json::Value& data) {
-        std::string dataStr = data.toStyledString(); // 将 JSON 数据转换为字符串
-
-        // 构造插入 SQL
-        std::string insertSQL = "INSERT INTO rtsp_logs (timestamp, ip_address, rtsp_url, data) VALUES ('"
-            + timestamp + "', '" + ip_address + "', '" + rtsp_url + "', '" + dataStr + "');";
-
-        char* errorMessage = nullptr;
-        if (sqlite3_exec(db, insertSQL.c_str(), nullptr, nullptr, &errorMessage) != SQLITE_OK) {
-            std::cerr << "SQL Error: " << errorMessage << std::endl;
-            sqlite3_free(errorMessage);
-        }
-        // else {
-        //     std::cout << "Log inserted successfully." << std::endl;
-        // }
-    }
+    // 写完队列中剩余的数据后关闭数据库
+    ~DatabaseManager();
+
+    // 插入一帧的检测结果, data 为序列化后的 JSON, 与其他输出端共享同一缓冲区
+    void insertLog(const std::string& timestamp, const std::string& ip_address, const std::string& rtsp_url,
+                   std::shared_ptr<const std::string> data);
+
+    // 插入一帧的结构化结果, detections 与二进制检测日志使用相同的记录格式
+    void insertFrame(const std::string& ip_address, const std::string& rtsp_url, int64_t timestamp_ms, uint64_t frame_id,
+                     std::vector<DetLogRecord> detections, std::vector<std::pair<std::string, int>> zone_counts);
+
+    // 插入徘徊事件, kind 为 "start" 或 "end"
+    void insertLoiterEvent(const std::string& ip_address, int track_id, const std::string& zone, const std::string& kind,
+                           int64_t enter_ms, int64_t event_ms, int64_t dwell_ms);
+
+    // 删除 beforeMs 之前的原始记录和 rollupBeforeMs 之前的分钟汇总, 小时汇总永久保留
+    // 删除在写线程中分块执行, 每块一个短事务, 有新数据待写时让出, 不影响正常写入
+    void prune(int64_t beforeMs, int64_t rollupBeforeMs);
+
+    // 等待队列中已有的数据全部提交
+    void flush();
+
+    uint64_t dropped() const;
+
+    // 数据库无法打开或语句预编译失败时为 true, 之后的写入只计入 db.errors
+    bool disabled() const { return disabled_; }
 
 private:
-    sqlite3* db;
+    struct LogRow {
+        std::string timestamp;
+        std::string ip_address;
+        std::string rtsp_url;
+        std::shared_ptr<const std::string> data;
+    };
+
+    struct LoiterRow {
+        std::string ip_address;
+        int track_id;
+        std::string zone;
+        std::string kind;
+        int64_t enter_ms;
+        int64_t event_ms;
+        int64_t dwell_ms;
+    };
+
+    struct FrameRow {
+        std::string ip_address;
+        std::string rtsp_url;
+        int64_t timestamp_ms;
+        uint64_t frame_id;
+        std::vector<DetLogRecord> detections;
+        std::vector<std::pair<std::string, int>> zone_counts;
+    };
+
+    using Row = std::variant<LogRow, LoiterRow, FrameRow>;
+
+    // 汇总键: (粒度, ip, 桶起始毫秒, 指标名), 粒度 0 为分钟, 1 为小时
+    using RollupKey = std::tuple<int, std::string, int64_t, std::string>;
+    struct RollupValue {
+        int64_t samples = 0;
+        int64_t total = 0;
+        int64_t maxValue = 0;
+    };
+
+    // 创建表
+    void createTable();
+    bool prepareStatements();
+    void disable(const std::string& dbName);
+    void enqueue(Row&& row);
+    void writerLoop();
+    void writeBatch(std::deque<Row>& batch);
+    void writeRow(const Row& row);
+    void writeFrame(const FrameRow& frame);
+    void addRollup(const std::string& ip_address, int64_t timestamp_ms, const std::string& metric, int64_t value);
+    void writeRollups();
+    // 删除一轮过期数据, 全部删完返回 true, 中途让出返回 false
+    bool pruneExpired(int64_t beforeMs, int64_t rollupBeforeMs);
+    bool step(sqlite3_stmt* stmt);
+
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insertLogStmt_ = nullptr;
+    sqlite3_stmt* insertLoiterStmt_ = nullptr;
+    sqlite3_stmt* insertFrameStmt_ = nullptr;
+    sqlite3_stmt* insertDetectionStmt_ = nullptr;
+    sqlite3_stmt* insertZoneCountStmt_ = nullptr;
+    sqlite3_stmt* upsertTrackStmt_ = nullptr;
+    sqlite3_stmt* upsertRollupStmt_[2] = {nullptr, nullptr};   // 分钟, 小时
+    std::vector<sqlite3_stmt*> pruneStmts_;
+
+    std::map<RollupKey, RollupValue> rollups_;   // 当前批次的汇总增量, 只在写线程中访问
+
+    size_t batchSize_;
+    int flushIntervalMs_;
+    size_t maxPending_;
+    int64_t sessionMs_;                   // 进程启动时间, 区分重启后重新编号的跟踪 ID
+    bool disabled_ = false;               // 只在构造函数中设置, 之后只读
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;          // 通知写线程有新数据
+    std::condition_variable drainedCv_;   // 通知 flush 队列已写完
+    std::deque<Row> pending_;
+    size_t inFlight_ = 0;                 // 写线程正在提交的记录数
+    uint64_t dropped_ = 0;
+    bool flushRequested_ = false;
+    bool pruneRequested_ = false;
+    int64_t pruneBeforeMs_ = 0;
+    int64_t pruneRollupBeforeMs_ = 0;
+    bool quit_ = false;
+    std::thread writer_;
 };
+
+#endif // DATABASEMANAGER_H
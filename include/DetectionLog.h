@@ -0,0 +1,126 @@
+#ifndef DETECTIONLOG_H
+#define DETECTIONLOG_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 追加写的二进制检测日志
+// 日志目录下按时间切分为多个段文件 <首条记录毫秒时间戳>.dlog, 段内为定长记录, 可直接 mmap 读取;
+// 段文件可以放在日志目录的子目录中 (如存储管理的小时分片 <YYYYMMDD>/<HH>/), 读取端递归查找;
+// 每个段另有稀疏索引文件 <同名>.idx, 每 indexStride 条记录保存一次 (时间戳, 采集序号, 记录序号)
+// 帧ID在队列长度处循环, 不能作为索引键; 按帧查询使用采集序号, 它在进程内单调递增、不循环
+
+// 记录所属的模型
+enum class DetLogModel : uint8_t {
+    Person = 0,
+    Fall = 1,
+    FireSmoke = 2
+};
+
+// 一个检测结果, 定长 48 字节
+struct DetLogRecord {
+    int64_t timestampMs;     // 采集时间 (毫秒)
+    uint64_t sequence;       // 采集序号, 进程重启后从 0 开始
+    int32_t trackId;         // 跟踪 ID, 无跟踪的模型为 -1
+    float confidence;
+    float x, y, width, height;
+    uint8_t model;           // DetLogModel
+    uint8_t classId;         // 火焰 0 / 烟雾 1, 其他模型为 0
+    uint16_t reserved0;
+    uint32_t frameID;        // 帧ID (循环使用), 与结果文件名对应
+};
+static_assert(sizeof(DetLogRecord) == 48, "DetLogRecord must stay 48 bytes");
+
+// 段文件头, 定长 64 字节, 记录紧随其后
+struct DetLogSegmentHeader {
+    char magic[8];           // "AIBXDLG1"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;       // 段内可容纳的记录数
+    uint64_t recordCount;    // 已写入的记录数, 写入记录后才更新
+    int64_t firstTimestampMs;
+    int64_t lastTimestampMs;
+    uint64_t firstSequence;
+    uint64_t lastSequence;
+};
+static_assert(sizeof(DetLogSegmentHeader) == 64, "DetLogSegmentHeader must stay 64 bytes");
+
+// 稀疏索引项
+struct DetLogIndexEntry {
+    int64_t timestampMs;
+    uint64_t sequence;
+    uint64_t recordIdx;
+};
+
+// 写入端, 只允许一个线程调用
+class DetectionLogWriter {
+public:
+    // segmentRecords: 每段最多记录数; segmentSpanMs: 每段最长覆盖时间; indexStride: 稀疏索引间隔
+    explicit DetectionLogWriter(const std::string& dir, uint64_t segmentRecords = 1 << 20,
+                                int64_t segmentSpanMs = 3600 * 1000, uint32_t indexStride = 1024);
+
+    // 关闭当前段, 文件截断为实际大小
+    ~DetectionLogWriter();
+
+    DetectionLogWriter(const DetectionLogWriter&) = delete;
+    DetectionLogWriter& operator=(const DetectionLogWriter&) = delete;
+
+    // 段文件目录由 dirFor 按帧时间给出 (如 StorageManager 的小时分片), 目录变化时换段, 使每个段只属于一个分片;
+    // 未设置时所有段都写在 dir 下. 需在第一次 append 之前调用
+    void setDirectoryProvider(std::function<std::string(int64_t timestampMs)> dirFor) { dirFor_ = std::move(dirFor); }
+
+    // 追加一帧的所有检测结果, 时间戳需单调不减
+    int append(const std::vector<DetLogRecord>& records);
+
+    // 将已写入的数据刷到磁盘
+    void sync();
+
+private:
+    int openSegment(const std::string& dir, int64_t timestampMs);
+    void closeSegment();
+
+    std::string dir_;
+    std::function<std::string(int64_t)> dirFor_;
+    std::string segmentDir_;     // 当前段所在目录
+    uint64_t segmentRecords_;
+    int64_t segmentSpanMs_;
+    uint32_t indexStride_;
+
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t mapSize_ = 0;
+    DetLogSegmentHeader* header_ = nullptr;
+    DetLogRecord* records_ = nullptr;
+    FILE* indexFile_ = nullptr;
+};
+
+// 读取端, 可以在写入的同时在其他进程中读取
+class DetectionLogReader {
+public:
+    explicit DetectionLogReader(const std::string& dir);
+
+    // 扫描目录中的段文件
+    int open();
+
+    // 按时间范围 [beginMs, endMs) 扫描, 回调返回 false 时停止, 返回扫描到的记录数
+    uint64_t scanTime(int64_t beginMs, int64_t endMs, const std::function<bool(const DetLogRecord&)>& fn) const;
+
+    // 按采集序号范围 [beginSequence, endSequence) 扫描
+    uint64_t scanSequence(uint64_t beginSequence, uint64_t endSequence,
+                          const std::function<bool(const DetLogRecord&)>& fn) const;
+
+    struct SegmentInfo {
+        std::string path;
+        DetLogSegmentHeader header;
+    };
+
+    const std::vector<SegmentInfo>& segments() const { return segments_; }
+
+private:
+    std::string dir_;
+    std::vector<SegmentInfo> segments_;
+};
+
+#endif // DETECTIONLOG_H
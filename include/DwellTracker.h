@@ -0,0 +1,55 @@
+#ifndef DWELLTRACKER_H
+#define DWELLTRACKER_H
+
+#include <cstdint>
+#include <vector>
+#include "TrackStateMap.h"
+
+// 徘徊事件: 开始事件在停留时间首次超过阈值时产生, 结束事件在该目标离开区域时产生
+struct LoiterEvent {
+    enum Kind { Start, End };
+    Kind kind;
+    int trackId;
+    size_t zoneIdx;
+    int64_t enterMs;     // 进入区域的时间
+    int64_t eventMs;     // 事件发生的时间
+    int64_t dwellMs;     // 截至事件发生时的停留时间
+};
+
+// 区域停留时间统计: 以 (跟踪 ID, 区域) 为键记录进入/最后出现时间, 容量固定
+class DwellTracker {
+public:
+    explicit DwellTracker(size_t capacity = 1024, int64_t loiterThresholdMs = 60000, int64_t exitGraceMs = 3000);
+
+    void setLoiterThreshold(int64_t loiterThresholdMs) { loiterThresholdMs_ = loiterThresholdMs; }
+
+    // 离开判定的宽限时间, 需大于送帧间隔, 否则每帧之间条目都会过期
+    void setExitGrace(int64_t exitGraceMs) { exitGraceMs_ = exitGraceMs; }
+
+    // 目标本帧位于区域内
+    void update(int trackId, size_t zoneIdx, int64_t nowMs, std::vector<LoiterEvent>& events);
+
+    // 结束一帧: 超过 exitGraceMs 未在区域内出现的条目视为已离开
+    void endFrame(int64_t nowMs, std::vector<LoiterEvent>& events);
+
+    size_t size() const { return entries_.size(); }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct DwellState {
+        int64_t enterMs = 0;
+        int64_t lastSeenMs = 0;
+        bool loitering = false;
+    };
+
+    static uint64_t makeKey(int trackId, size_t zoneIdx) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(trackId)) << 16) | (zoneIdx & 0xffff);
+    }
+
+    TrackStateMap<DwellState> entries_;
+    int64_t loiterThresholdMs_;
+    int64_t exitGraceMs_;
+    uint64_t dropped_ = 0;          // 表满而未能记录的次数
+};
+
+#endif // DWELLTRACKER_H
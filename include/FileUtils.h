@@ -13,6 +13,8 @@ extern "C" {
 unsigned char *load_data(FILE *fp, size_t ofst, size_t sz);
 unsigned char *load_model(const char *filename, int *model_size);
 int saveFloat(const char *file_name, float *output, int element_size);
+// 当前进程常驻内存 (KB), 读取失败返回 -1
+long resident_kb(void);
 
 #ifdef __cplusplus
 }
@@ -1,7 +1,7 @@
 #ifndef FIRESMOKEDETECT_H
 #define FIRESMOKEDETECT_H
 
-#include "BaseModel.h"
+#include "RknnModel.h"
 #include <vector>
 #include <opencv2/core.hpp> // 确保包含OpenCV核心模块
 
@@ -35,29 +35,11 @@ struct FireSmokeDetResult {
 };
 
 
-// 火焰与烟雾检测类，继承自BaseModel
-class FireSmokeDet : public BaseModel<FireSmokeDetResult> {
+// 火焰与烟雾检测类: YOLOv8 检测头, 保留所有类别
+class FireSmokeDet final : public RknnModel<ResizePreprocessor, YoloBoxDecoder<FireSmokeDetResult>, FireSmokeDetResult> {
 public:
     // 默认构造函数
     FireSmokeDet();
-
-    // 初始化模型
-    int init(const std::string& modelPath) override;
-
-    // 获取RKNN上下文
-    rknn_context* get_rknn_context() override;
-
-    // 模型推理
-    int infer(const cv::Mat& inputData) override;
-
-    // 获取检测结果
-    FireSmokeDetResult getResult() const;
-
-    // 默认析构函数
-    ~FireSmokeDet();
-
-private:
-    FireSmokeDetResult result_; // 存储检测结果
 };
 
 #endif // FIRESMOKEDETECT_H
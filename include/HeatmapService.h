@@ -0,0 +1,61 @@
+#ifndef HEATMAPSERVICE_H
+#define HEATMAPSERVICE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// 人员占用热力图服务 (可选开启)
+// 推理/结果线程只提交跟踪框, 累加在独立线程中完成: 框先写入粗网格上的二维差分数组,
+// 前缀和得到本帧占用后按指数衰减累加. 只有请求快照时才渲染伪彩色图.
+class HeatmapService {
+public:
+    explicit HeatmapService(int cellSize = 16, float decay = 0.99f, size_t maxPending = 64);
+    ~HeatmapService();
+
+    // 启动/停止累加线程, 未启动时 submit 直接忽略
+    void start();
+    void stop();
+    bool running() const { return running_; }
+
+    // 按视频尺寸预先分配网格, 避免在第一帧累加时分配
+    void prepare(const cv::Size& frameSize);
+
+    // 提交一帧的跟踪框, 只做入队, 队列满时丢弃最旧的一帧
+    void submit(const cv::Size& frameSize, const std::vector<cv::Rect_<float>>& boxes);
+
+    // 渲染当前热力图, background 非空时按 0.5/0.5 与之混合, 输出尺寸与原图一致
+    cv::Mat snapshot(const cv::Mat& background = cv::Mat());
+
+private:
+    struct Job {
+        cv::Size frameSize;
+        std::vector<cv::Rect_<float>> boxes;
+    };
+
+    void worker();
+    void accumulate(const Job& job);
+    void resize(const cv::Size& frameSize);
+
+    int cellSize_;                    // 网格大小 (像素)
+    float decay_;                     // 每帧衰减系数
+    size_t maxPending_;               // 最大待处理帧数
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    std::mutex queueMtx_;
+    std::condition_variable queueCv_;
+    std::deque<Job> pending_;
+
+    std::mutex heatMtx_;              // 保护以下累加状态
+    cv::Size frameSize_;              // 原图尺寸
+    int gridW_ = 0, gridH_ = 0;       // 网格尺寸
+    std::vector<float> diff_;         // 差分数组 (gridH_ + 1) x (gridW_ + 1)
+    std::vector<float> heat_;         // 累加后的热力值 gridH_ x gridW_
+};
+
+#endif // HEATMAPSERVICE_H
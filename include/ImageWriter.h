@@ -0,0 +1,71 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+
+enum class ImageFormat {
+    JPEG,
+    WEBP,
+    PNG
+};
+
+// 积压时的处理策略
+enum class BacklogPolicy {
+    DropNewest,   // 丢弃新提交的图像
+    DropOldest,   // 丢弃队列中最旧的图像
+    Coalesce      // 同一类别只保留最新的一张, 队列仍满时丢弃最旧的
+};
+
+// 结果图像异步编码写盘线程池, 调用线程只做入队
+class ImageWriter {
+public:
+    // quality: JPEG/WebP 为 0-100 的质量, PNG 为 0-9 的压缩等级
+    explicit ImageWriter(size_t threadNum = 2, size_t maxPending = 8, ImageFormat format = ImageFormat::JPEG,
+                         int quality = 90, BacklogPolicy policy = BacklogPolicy::Coalesce);
+
+    // 写完队列中剩余的图像后退出
+    ~ImageWriter();
+
+    // 提交一张图像, pathNoExt 不含扩展名; 提交后调用方不能再修改 image 的像素数据
+    // 返回 false 表示图像被丢弃
+    bool write(const std::string& category, const std::string& pathNoExt, const cv::Mat& image);
+
+    // 等待已提交的图像全部写完
+    void flush();
+
+    // 当前格式对应的扩展名, 如 ".jpg"
+    const std::string& extension() const { return extension_; }
+
+private:
+    struct Job {
+        std::string category;
+        std::string path;
+        cv::Mat image;
+    };
+
+    void worker();
+    void encode(const Job& job);
+
+    ImageFormat format_;
+    std::vector<int> params_;        // imwrite 编码参数
+    std::string extension_;
+    BacklogPolicy policy_;
+    size_t maxPending_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable drainedCv_;
+    std::deque<Job> pending_;
+    size_t busy_ = 0;                // 正在编码的任务数
+    bool quit_ = false;
+    std::vector<std::thread> threads_;
+};
+
+#endif // IMAGEWRITER_H
@@ -0,0 +1,63 @@
+#ifndef LINECOUNTER_H
+#define LINECOUNTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "TrackStateMap.h"
+
+// 有向计数线段, forward 表示从 p1->p2 方向的左手侧穿越到右手侧
+// (图像坐标系下, 一条水平向右的线对应从上往下穿越)
+struct CountLine {
+    std::string name;
+    cv::Point2f p1, p2;
+};
+
+struct LineCount {
+    uint64_t forward = 0;
+    uint64_t backward = 0;
+};
+
+// 一次越线事件
+struct LineCrossing {
+    int trackId;
+    size_t lineIdx;
+    bool forward;
+};
+
+// 越线计数引擎: 每个跟踪 ID 只保存上一帧的中心点, 每帧每条轨迹 O(线段数) 的计算,
+// 长时间未出现的轨迹会被淘汰
+class LineCounter {
+public:
+    explicit LineCounter(size_t maxTracks = 1024, uint32_t maxMissedFrames = 30);
+
+    void setLines(const std::vector<CountLine>& lines);
+
+    // 开始新的一帧
+    void beginFrame();
+
+    // 更新一条轨迹的位置, 发生的越线事件追加到 crossings
+    void update(int trackId, const cv::Rect_<float>& box, std::vector<LineCrossing>& crossings);
+
+    // 结束一帧, 淘汰超过 maxMissedFrames 帧未出现的轨迹
+    void endFrame();
+
+    const std::vector<CountLine>& lines() const { return lines_; }
+    const std::vector<LineCount>& counts() const { return counts_; }
+    size_t trackCount() const { return tracks_.size(); }
+
+private:
+    struct TrackState {
+        cv::Point2f centroid;
+        uint32_t lastFrame = 0;
+    };
+
+    std::vector<CountLine> lines_;
+    std::vector<LineCount> counts_;
+    TrackStateMap<TrackState> tracks_;
+    uint32_t maxMissedFrames_;
+    uint32_t frame_ = 0;
+};
+
+#endif // LINECOUNTER_H
@@ -0,0 +1,41 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <json/json.h>
+
+// 进程内指标: 计数器 / 瞬时值 / 统计量 (次数、总和、最大值), 以 JSON 形式导出
+class Metrics {
+public:
+    static Metrics& instance();
+
+    // 计数器累加
+    void add(const std::string& name, int64_t delta = 1);
+
+    // 设置瞬时值, 如队列深度
+    void set(const std::string& name, double value);
+
+    // 记录一次观测值, 如耗时 (ms)
+    void observe(const std::string& name, double value);
+
+    Json::Value toJson() const;
+
+private:
+    Metrics() = default;
+
+    struct Summary {
+        uint64_t count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+    };
+
+    mutable std::mutex mtx_;
+    std::map<std::string, int64_t> counters_;
+    std::map<std::string, double> gauges_;
+    std::map<std::string, Summary> summaries_;
+};
+
+#endif // METRICS_H
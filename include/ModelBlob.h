@@ -0,0 +1,34 @@
+#ifndef MODELBLOB_H
+#define MODELBLOB_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// 只读映射的模型文件
+// 同一路径在进程内只映射一次, 通过引用计数共享; 最后一个持有者释放后解除映射.
+// 映射为私有写时复制, rknn_init 即使改写缓冲区也不会影响文件和其他持有者
+class ModelBlob {
+public:
+    // 打开失败返回空指针
+    static std::shared_ptr<const ModelBlob> open(const std::string& path);
+
+    ~ModelBlob();
+
+    ModelBlob(const ModelBlob&) = delete;
+    ModelBlob& operator=(const ModelBlob&) = delete;
+
+    const std::string& path() const { return path_; }
+    unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    ModelBlob(const std::string& path, unsigned char* data, size_t size)
+        : path_(path), data_(data), size_(size) {}
+
+    std::string path_;
+    unsigned char* data_;
+    size_t size_;
+};
+
+#endif // MODELBLOB_H
@@ -0,0 +1,138 @@
+#ifndef MODELSTAGES_H
+#define MODELSTAGES_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include "rknn_api.h"
+#include "postprocess.h"
+
+// 前处理和后处理之间传递的信息
+struct FrameContext {
+    // 每个实例固定, init 时设置
+    cv::Size inputSize;                   // 模型输入尺寸
+    float boxThreshold = 0.5f;            // 检测框置信度阈值
+    float nmsThreshold = 0.5f;            // NMS 阈值
+    // 每帧由 RknnModel 和前处理更新
+    bool warmingUp = false;               // 预热中, 后处理不更新跨帧状态
+    cv::Size srcSize;                     // 原图尺寸
+    float scaleW = 1.0f, scaleH = 1.0f;   // 模型输入尺寸 / 原图尺寸
+    BOX_RECT pads{};                      // letterbox 填充
+};
+
+// 直接缩放到模型输入尺寸并转换为 RGB, 缓冲区按实例复用
+class ResizePreprocessor {
+public:
+    int init(const cv::Size& inputSize);
+
+    // 返回 NHWC RGB 输入缓冲区, 有效期到下一次调用
+    void* run(const cv::Mat& image, FrameContext& frame);
+
+private:
+    cv::Size inputSize_;
+    cv::Mat resized_, rgb_;
+};
+
+// 先转换为 RGB, 尺寸不同时用 RGA 缩放, 缓冲区按实例复用
+class RgaResizePreprocessor {
+public:
+    int init(const cv::Size& inputSize);
+
+    void* run(const cv::Mat& image, FrameContext& frame);
+
+private:
+    cv::Size inputSize_;
+    cv::Mat rgb_, resized_;
+};
+
+// YOLOv8 风格检测头解码: 输出 [1, 4 + 类别数, 候选框数], 前 4 行为 cx, cy, w, h (模型输入坐标)
+// 直接按列读取输出, 不转置; 中间结果按实例复用
+template <typename ResultType>
+class YoloBoxDecoder {
+public:
+    static constexpr bool kWantFloat = true;
+
+    // 只保留指定类别, -1 表示保留所有类别
+    void setClassFilter(int classId) { classFilter_ = classId; }
+
+    int init(const rknn_tensor_attr* outputAttrs, uint32_t outputNum, const FrameContext& frame) {
+        if (outputNum < 1) {
+            std::cerr << "YOLO decoder needs one output tensor" << std::endl;
+            return -1;
+        }
+        const rknn_tensor_attr& attr = outputAttrs[0];
+        if (attr.n_dims >= 3) {
+            numFeatures_ = static_cast<int>(attr.dims[1]);
+            numBoxes_ = static_cast<int>(attr.dims[2]);
+        }
+        if (numFeatures_ <= 4 || numBoxes_ <= 0) {
+            std::cerr << "Unexpected YOLO output shape: features=" << numFeatures_ << ", boxes=" << numBoxes_ << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    int decode(const rknn_output* outputs, const FrameContext& frame, ResultType& result) {
+        result.detections.clear();
+        boxes_.clear();
+        scores_.clear();
+        classIds_.clear();
+        const float* data = static_cast<const float*>(outputs[0].buf);
+        if (!data) {
+            return -1;
+        }
+
+        // 计算缩放因子
+        const float xFactor = static_cast<float>(frame.srcSize.width) / frame.inputSize.width;
+        const float yFactor = static_cast<float>(frame.srcSize.height) / frame.inputSize.height;
+        const int numClasses = numFeatures_ - 4;
+        for (int i = 0; i < numBoxes_; i++) {
+            // 取最大类别分数, 并列时取第一个
+            int classId = 0;
+            float maxScore = data[4 * numBoxes_ + i];
+            for (int c = 1; c < numClasses; c++) {
+                float score = data[(4 + c) * numBoxes_ + i];
+                if (score > maxScore) {
+                    maxScore = score;
+                    classId = c;
+                }
+            }
+            if (maxScore < frame.boxThreshold || (classFilter_ >= 0 && classId != classFilter_)) {
+                continue;
+            }
+            float x = data[i];
+            float y = data[numBoxes_ + i];
+            float w = data[2 * numBoxes_ + i];
+            float h = data[3 * numBoxes_ + i];
+            boxes_.emplace_back(static_cast<int>((x - w / 2) * xFactor), static_cast<int>((y - h / 2) * yFactor),
+                                static_cast<int>(w * xFactor), static_cast<int>(h * yFactor));
+            scores_.push_back(maxScore);
+            classIds_.push_back(classId);
+        }
+
+        // 非极大值抑制
+        cv::dnn::NMSBoxes(boxes_, scores_, frame.boxThreshold, frame.nmsThreshold, indices_);
+        result.detections.reserve(indices_.size());
+        for (int idx : indices_) {
+            typename decltype(result.detections)::value_type det;
+            det.id = classIds_[idx];
+            det.confidence = scores_[idx];
+            det.box = boxes_[idx];
+            result.detections.push_back(det);
+        }
+        return 0;
+    }
+
+private:
+    int classFilter_ = -1;
+    int numFeatures_ = 6;       // 4 + 类别数
+    int numBoxes_ = 8400;       // 候选框数
+    std::vector<cv::Rect> boxes_;
+    std::vector<float> scores_;
+    std::vector<int> classIds_;
+    std::vector<int> indices_;
+};
+
+#endif // MODELSTAGES_H
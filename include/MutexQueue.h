@@ -8,8 +8,10 @@
 #include <DetectionModels.h>
 
 struct ImageData {
-    uint64_t frameID; // 帧ID
+    uint64_t frameID; // 帧ID, 在队列长度处循环使用
+    uint64_t sequence = 0; // 采集序号, 进程内单调递增, 不循环
     std::string timestamp;
+    int64_t timestampMs = 0; // 采集时间 (Unix 毫秒)
     std::string ip;
     cv::Mat frame; // 原始图像
 };
@@ -38,17 +40,21 @@ public:
         if (size_ < capacity_) {
             size_++; // 队列未满，增加大小
         } else {
+            dropped_++;
             idMap_.erase(queue_[(head_ + capacity_ - 1) % capacity_].frameID); // 移除旧数据的 ID 映射
         }
     }
 
-    void push(uint64_t frameID, const cv::Mat& frame, const std::string& timestamp, const std::string& ip) {
+    void push(uint64_t frameID, const cv::Mat& frame, const std::string& timestamp, const std::string& ip, int64_t timestampMs = 0,
+              uint64_t sequence = 0) {
         std::lock_guard<std::mutex> lock(mutex_);
 
         // 更新队列
         queue_[head_].frameID = frameID; // 设置帧ID
         queue_[head_].frame = frame.clone(); // 深拷贝图像
         queue_[head_].timestamp = timestamp; // 设置时间戳
+        queue_[head_].timestampMs = timestampMs;
+        queue_[head_].sequence = sequence;
         queue_[head_].ip = ip; // 设置 IP 地址
 
         // 更新映射
@@ -61,6 +67,7 @@ public:
         if (size_ < capacity_) {
             size_++;
         } else {
+            dropped_++;
             // 移除旧数据的 ID 映射
             idMap_.erase(queue_[(head_ + capacity_ - 1) % capacity_].frameID);
         }
@@ -103,6 +110,12 @@ public:
         return size_ == 0; // 返回队列是否为空
     }
 
+    // 队列满时被覆盖的帧数, 清空队列不重置
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
     void clear() {
         std::lock_guard<std::mutex> lock(mutex_);
         queue_.clear(); // 清空队列
@@ -113,6 +126,15 @@ public:
         queue_.resize(capacity_); // 重新调整队列大小
     }
 
+    // 修改容量并清空队列, 只能在生产和消费线程启动之前调用
+    void setCapacity(size_t capacity) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+        }
+        clear();
+    }
+
 private:
     std::vector<ImageData> queue_; // 存储数据的循环队列
     std::unordered_map<uint64_t, size_t> idMap_; // ID 到索引的映射
@@ -120,6 +142,7 @@ private:
     size_t head_; // 当前插入位置
     size_t tail_ = 0; // 当前移除位置
     size_t size_; // 当前队列大小
+    uint64_t dropped_ = 0; // 覆盖丢弃的帧数
     mutable std::mutex mutex_; // 保护队列和映射的互斥锁
 };
 
@@ -141,11 +164,13 @@ public:
         if (size_ < capacity_) {
             size_++; // 队列未满，增加大小
         } else {
+            dropped_++;
             idMap_.erase(queue_[(head_ + capacity_ - 1) % capacity_].imageData.frameID); // 移除旧数据的 ID 映射
         }
     }
 
-    void push(uint64_t frameID, const cv::Mat& frame, const std::string& timestamp, const std::string& ip) {
+    void push(uint64_t frameID, const cv::Mat& frame, const std::string& timestamp, const std::string& ip, int64_t timestampMs = 0,
+              uint64_t sequence = 0) {
         std::lock_guard<std::mutex> lock(mutex_);
 
         // 创建 FrameData 对象，并设置图像数据
@@ -153,6 +178,8 @@ public:
         frameData.imageData.frameID = frameID;    // 设置帧ID
         frameData.imageData.frame = frame.clone(); // 深拷贝图像
         frameData.imageData.timestamp = timestamp;  // 设置时间戳
+        frameData.imageData.timestampMs = timestampMs;
+        frameData.imageData.sequence = sequence;
         frameData.imageData.ip = ip;                // 设置 IP 地址
 
         queue_[head_] = frameData; // 替换当前位置的数据
@@ -162,6 +189,7 @@ public:
         if (size_ < capacity_) {
             size_++; // 队列未满，增加大小
         } else {
+            dropped_++;
             // 移除旧数据的 ID 映射
             idMap_.erase(queue_[(head_ + capacity_ - 1) % capacity_].imageData.frameID);
         }
@@ -230,6 +258,12 @@ public:
         return size_ == 0; // 返回队列是否为空
     }
 
+    // 队列满时被覆盖的帧数, 清空队列不重置
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
     // 清空队列
     void clear() {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -241,6 +275,15 @@ public:
         queue_.resize(capacity_); // 重新调整队列大小
     }
 
+    // 修改容量并清空队列, 只能在生产和消费线程启动之前调用
+    void setCapacity(size_t capacity) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+        }
+        clear();
+    }
+
 private:
     std::vector<FrameData> queue_; // 存储数据的循环队列
     std::unordered_map<uint64_t, size_t> idMap_; // ID 到索引的映射
@@ -248,6 +291,7 @@ private:
     size_t head_; // 当前插入位置
     size_t tail_ = 0; // 当前移除位置
     size_t size_; // 当前队列大小
+    uint64_t dropped_ = 0; // 覆盖丢弃的帧数
     mutable std::mutex mutex_; // 保护队列和映射的互斥锁
 };
 
@@ -0,0 +1,68 @@
+#ifndef OVERLAYRENDERER_H
+#define OVERLAYRENDERER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// 叠加图层, 输出图像按图层组合
+enum OverlayLayer : uint32_t {
+    LayerPerson    = 1u << 0,
+    LayerZones     = 1u << 1,
+    LayerFall      = 1u << 2,
+    LayerFireSmoke = 1u << 3,
+    LayerAll       = 0xffffffffu
+};
+
+// 叠加渲染层
+// 各模型结果只登记要绘制的元素, 只有图像输出端真正需要时才按图层组合一次性绘制到原图副本上,
+// 同一帧同一组合只绘制一次; headless 模式下不登记也不绘制
+class OverlayRenderer {
+public:
+    explicit OverlayRenderer(bool headless = false) : headless_(headless) {}
+
+    void setHeadless(bool headless) { headless_ = headless; }
+    bool headless() const { return headless_; }
+
+    // 开始新的一帧, 只保存原图引用, 帧处理期间原图不能被修改
+    void begin(const cv::Mat& frame);
+
+    // 带编号标签的检测框, colorId 决定颜色
+    void addBox(uint32_t layer, const cv::Rect_<float>& box, const std::string& label, int colorId);
+
+    // 多边形区域, polygon 需在本帧结束前保持有效
+    void addPolygon(uint32_t layer, const std::vector<cv::Point>* polygon);
+
+    void addText(uint32_t layer, const std::string& text, cv::Point origin, double scale, int thickness);
+
+    // 返回包含指定图层的图像; headless 时返回空图像
+    cv::Mat render(uint32_t layers);
+
+    // 结束一帧, 记录本帧渲染耗时
+    void end();
+
+private:
+    struct Item {
+        enum Kind { Box, Polygon, Text } kind;
+        uint32_t layer;
+        cv::Rect_<float> box;
+        std::string text;
+        cv::Scalar color;
+        const std::vector<cv::Point>* polygon;
+        cv::Point origin;
+        double scale;
+        int thickness;
+    };
+
+    void draw(cv::Mat& image, const Item& item) const;
+
+    bool headless_;
+    cv::Mat frame_;
+    std::vector<Item> items_;
+    std::vector<std::pair<uint32_t, cv::Mat>> rendered_;  // 本帧已渲染的图层组合
+    double frameRenderMs_ = 0;
+};
+
+#endif // OVERLAYRENDERER_H
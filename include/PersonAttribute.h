@@ -1,7 +1,7 @@
 #ifndef PERSONATTRIBUTE_H
 #define PERSONATTRIBUTE_H
 
-#include "BaseModel.h"
+#include "RknnModel.h"
 #include <vector>
 #include <opencv2/core.hpp> // 确保包含OpenCV核心模块
 
@@ -33,29 +33,21 @@ struct PerAttrResult {
     }
 };
 
-// 类定义，继承自BaseModel
-class PerAttr : public BaseModel<PerAttrResult> {
+// 人员属性后处理: 第一个输出即各属性的概率
+class PerAttrDecoder {
 public:
-    // 默认构造函数
-    PerAttr();
-
-    // 初始化模型
-    int init(const std::string& modelPath) override;
+    static constexpr bool kWantFloat = true;
 
-    // 获取RKNN上下文
-    rknn_context* get_rknn_context() override;
+    int init(const rknn_tensor_attr* outputAttrs, uint32_t outputNum, const FrameContext& frame);
 
-    // 模型推理
-    int infer(const cv::Mat& inputData) override;
-
-    // 获取检测结果
-    PerAttrResult getResult() const;
-
-    // 默认构造函数
-    ~PerAttr();
+    int decode(const rknn_output* outputs, const FrameContext& frame, PerAttrResult& result);
 
 private:
-    PerAttrResult result_;    // 存储检测结果
+    size_t numAttributes_ = 0;   // 属性个数
+};
+
+// 人员属性识别类
+class PerAttr final : public RknnModel<ResizePreprocessor, PerAttrDecoder, PerAttrResult> {
 };
 
 #endif // PERSONATTRIBUTE_H
@@ -1,9 +1,11 @@
 #ifndef PERSONDETECT_H
 #define PERSONDETECT_H
 
-#include "BaseModel.h"
+#include "RknnModel.h"
 #include <vector>
 #include <opencv2/core/core.hpp> // 确保包含OpenCV核心模块
+#include "postprocess.h"
+#include "sort.h"
 
 // 检测结果结构体
 struct PerDetection {
@@ -34,32 +36,47 @@ struct PerDetResult {
     }
 };
 
-// 人物检测类，继承自 BaseModel
-class PerDet : public BaseModel<PerDetResult> {
+// 人员跟踪 (SORT) 参数
+struct PerDetTrackParams {
+    int maxAge = 2;              // 轨迹连续丢失多少帧后删除
+    int minHits = 3;             // 轨迹连续命中多少帧后输出
+    float iouThreshold = 0.01f;  // 关联的最小 IoU
+    float lowThreshold = 0.1f;   // 低分检测阈值, 低于 box_conf_threshold_ 的检测只用于维持已有轨迹 (<= 0 关闭)
+    float lowIou = 0.3f;         // 低分检测二次关联的 IoU 阈值
+};
+
+// 人物检测后处理: YOLOv5 int8 输出解码 + SORT 跟踪
+// 解码结果和跟踪输入在实例内复用; 跟踪会话由模型池共用
+class PerDetDecoder {
 public:
-    // 默认构造函数
-    PerDet();
+    static constexpr bool kWantFloat = false;
+
+    void setTrackParams(const PerDetTrackParams& params) { track_ = params; }
+    void setLabelsPath(const std::string& path) { labelsPath_ = path; }
 
-    // 初始化模型
-    int init(const std::string& modelPath) override;
+    int init(const rknn_tensor_attr* outputAttrs, uint32_t outputNum, const FrameContext& frame);
 
-    // 获取 RKNN 上下文
-    rknn_context* get_rknn_context() override;
+    int decode(const rknn_output* outputs, const FrameContext& frame, PerDetResult& result);
 
-    // 模型推理
-    int infer(const cv::Mat& inputData) override;
+private:
+    PerDetTrackParams track_;              // 跟踪参数
+    std::string labelsPath_;               // 类别标签文件, 为空时使用默认路径
+    std::vector<float> outScales_;         // 输出量化参数
+    std::vector<int32_t> outZps_;
+    detect_result_group_t group_;          // 解码结果
+    std::vector<DetectionBox> boxes_;      // SORT 输入
+};
 
-    // 获取检测结果
-    PerDetResult getResult() const;
+// 人物检测类
+class PerDet final : public RknnModel<RgaResizePreprocessor, PerDetDecoder, PerDetResult> {
+public:
+    PerDet();
 
-    // 默认析构函数
-    ~PerDet();
+    // 设置跟踪参数, 需在 init 之前调用; 跟踪会话由模型池中第一个初始化的实例创建
+    void setTrackParams(const PerDetTrackParams& params) { decoder_.setTrackParams(params); }
 
-private:
-    PerDetResult result_;          // 存储检测结果
-    cv::Mat heatmap_;              // 热力图（如果需要）
-    float nms_threshold_;          // 非极大值抑制阈值
-    float box_conf_threshold_;     // 检测框置信度阈值
+    // 设置类别标签文件, 需在 init 之前调用; 标签在进程内只加载一次
+    void setLabelsPath(const std::string& path) { decoder_.setLabelsPath(path); }
 };
 
 #endif // PERSONDETECT_H
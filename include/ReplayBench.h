@@ -0,0 +1,85 @@
+#ifndef REPLAYBENCH_H
+#define REPLAYBENCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <json/json.h>
+
+// 端到端回放基准测试, 通过 --bench 开启: 记录每帧经过采集 → 推理 → 汇总输出各阶段的时间点,
+// 视频结束后输出吞吐量、各阶段延迟分位数 (p50/p95/p99)、各阶段 CPU 时间、峰值内存和丢帧, 格式为 JSON
+class ReplayBench {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static ReplayBench& instance();
+
+    // 在任何线程启动之前调用; rate 为送帧速率 (帧/秒), 0 表示不限速
+    // info 原样写入报告, 如视频源、推理后端和模型配置
+    void start(const std::string& reportPath, double rate, const Json::Value& info);
+
+    bool enabled() const { return enabled_; }
+    double rate() const { return rate_; }
+
+    // 帧经过各阶段的时间点, 帧ID在在途帧中唯一
+    // inferStarted/inferFinished 由模型池任务在推理开始和结果发布时调用, 每个模型各一次:
+    // 第一个模型开始推理到最后一个模型发布结果记为 infer, 之后到汇总线程取到这一帧记为 wait
+    void frameCaptured(uint64_t frameID);
+    void inferStarted(uint64_t frameID);
+    void inferFinished(uint64_t frameID);
+    void resultStarted(uint64_t frameID);
+    void resultFinished(uint64_t frameID);
+
+    // 已采集但还没有输出结果的帧数, 不限速时用于反压
+    uint64_t inFlight() const { return captured_ - finished_; }
+
+    // 记录一次阶段耗时 (ms)
+    void observe(const std::string& stage, double ms);
+
+    // 把当前线程自 lastCpuMs 以来的 CPU 时间计入阶段, 并更新 lastCpuMs
+    void chargeCpu(const std::string& stage, double& lastCpuMs);
+
+    // 丢帧计数, 按原因分别统计
+    void addDrops(const std::string& reason, uint64_t count);
+
+    // 写出报告, metrics 为运行指标快照, 其中各模块的丢弃计数汇总到 drops
+    int writeReport(const Json::Value& metrics);
+
+    // 当前线程的 CPU 时间 (ms)
+    static double threadCpuMs();
+
+private:
+    ReplayBench() = default;
+
+    struct FrameTimes {
+        Clock::time_point captured;
+        Clock::time_point inferStarted;
+        Clock::time_point inferFinished;
+        Clock::time_point resultStarted;
+    };
+
+    void observeLocked(const std::string& stage, Clock::time_point from, Clock::time_point to);
+
+    bool enabled_ = false;
+    double rate_ = 0.0;
+    std::string reportPath_;
+    Json::Value info_;
+
+    std::atomic<uint64_t> captured_{0};
+    std::atomic<uint64_t> finished_{0};
+    Clock::time_point firstCapture_;
+    Clock::time_point lastFinish_;
+
+    mutable std::mutex mtx_;
+    std::unordered_map<uint64_t, FrameTimes> frames_;
+    std::map<std::string, std::vector<double>> samples_;
+    std::map<std::string, double> cpuMs_;
+    std::map<std::string, uint64_t> drops_;
+};
+
+#endif // REPLAYBENCH_H
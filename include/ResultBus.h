@@ -0,0 +1,96 @@
+#ifndef RESULTBUS_H
+#define RESULTBUS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+
+// 总线上传递的一帧汇总结果, 所有订阅者共享同一份只读数据
+struct ResultMessage {
+    uint64_t frameID;
+    int64_t captureMs;                                  // 采集时间 (毫秒)
+    std::chrono::steady_clock::time_point publishTime;  // 发布时间, 用于统计投递延迟
+    std::shared_ptr<const Json::Value> root;            // 结构化结果, 进程内订阅者使用
+    std::shared_ptr<const std::string> payload;         // MessagePack 编码, 只在有订阅者需要时生成
+};
+
+// 进程内发布/订阅结果总线
+// 每个订阅者有独立的有界队列和投递线程, 慢订阅者只会丢弃自己队列中最旧的消息, 不影响发布者和其他订阅者
+class ResultBus {
+public:
+    // 回调返回 false 表示订阅者不再接收, 之后会被自动移除
+    using Callback = std::function<bool(const ResultMessage&)>;
+
+    ResultBus() = default;
+    ~ResultBus();
+
+    ResultBus(const ResultBus&) = delete;
+    ResultBus& operator=(const ResultBus&) = delete;
+
+    // name 用于指标名 bus.<name>.*; wantPayload 为 true 时消息中带 MessagePack 编码
+    int subscribe(const std::string& name, Callback callback, size_t capacity = 16, bool wantPayload = false);
+    void unsubscribe(int id);
+
+    // 发布一帧结果, 不会阻塞在订阅者上
+    void publish(uint64_t frameID, int64_t captureMs, std::shared_ptr<const Json::Value> root);
+
+    size_t subscriberCount() const;
+
+private:
+    struct Subscriber {
+        int id;
+        std::string name;
+        Callback callback;
+        size_t capacity;
+        bool wantPayload;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::shared_ptr<const ResultMessage>> queue;
+        bool quit = false;
+        std::atomic<bool> finished{false};  // 回调返回 false 后置位
+        std::thread thread;
+    };
+
+    void deliverLoop(Subscriber* subscriber);
+    static void stopSubscriber(const std::shared_ptr<Subscriber>& subscriber);
+
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<Subscriber>> subscribers_;
+    int nextId_ = 1;
+};
+
+// 通过 Unix 域套接字把总线上的结果推送给外部进程
+// 每个连接是一个订阅者, 消息格式为 4 字节大端长度 + MessagePack 编码的帧结果
+class ResultBusSocketServer {
+public:
+    ResultBusSocketServer(ResultBus& bus, const std::string& path, size_t clientQueue = 64);
+    ~ResultBusSocketServer();
+
+    int start();
+    void stop();
+
+private:
+    void acceptLoop();
+
+    ResultBus& bus_;
+    std::string path_;
+    size_t clientQueue_;
+    int listenFd_ = -1;
+    std::atomic<bool> quit_{false};
+    std::thread acceptThread_;
+
+    std::mutex mtx_;
+    std::vector<int> clients_;            // 订阅 ID
+};
+
+#endif // RESULTBUS_H
@@ -0,0 +1,47 @@
+#ifndef RESULTSERIALIZER_H
+#define RESULTSERIALIZER_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+
+enum class ResultEncoding {
+    Json,       // 紧凑 JSON, 无缩进和换行
+    MsgPack     // MessagePack 二进制, 供高频率的消费者使用
+};
+
+// 一帧结果的单次序列化
+// 每个子树只序列化一次: 片段既可直接写入各模型的结果文件, 也在 finish 时拼接成整帧数据,
+// 整帧数据以共享缓冲区的形式交给文件、数据库等所有输出端
+class ResultSerializer {
+public:
+    explicit ResultSerializer(ResultEncoding encoding = ResultEncoding::Json);
+
+    // 开始新的一帧, 保留已分配的缓冲区
+    void reset();
+
+    // 序列化 root 中的一个子树并缓存, 返回序列化后的片段
+    // 缓存后不应再修改 root 中对应的子树
+    const std::string& add(const std::string& key, const Json::Value& value);
+
+    // 按 root 的成员顺序拼接整帧数据, 已缓存的子树直接复用片段
+    std::shared_ptr<const std::string> finish(const Json::Value& root);
+
+    ResultEncoding encoding() const { return encoding_; }
+
+    static void writeJson(const Json::Value& value, std::string& out);
+    static void writeMsgPack(const Json::Value& value, std::string& out);
+
+private:
+    void writeValue(const Json::Value& value, std::string& out) const;
+    void writeKey(const char* key, size_t len, std::string& out) const;
+
+    ResultEncoding encoding_;
+    std::vector<std::pair<std::string, std::string>> fields_;   // 子树名, 序列化片段
+    size_t fieldCount_ = 0;                                     // 当前帧使用的 fields_ 数量
+    size_t lastSize_ = 256;                                     // 上一帧大小, 用于预分配
+};
+
+#endif // RESULTSERIALIZER_H
@@ -0,0 +1,338 @@
+#ifndef RKNNMODEL_H
+#define RKNNMODEL_H
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "BaseModel.h"
+#include "ModelStages.h"
+
+// 通用 RKNN 模型: 上下文创建、属性查询、输入输出设置和推理流程只实现一次,
+// 前处理 (Preprocessor) 和后处理 (Decoder) 作为模板参数在编译期组合.
+// 逐帧使用的缓冲区 (输出缓冲区、前处理图像、后处理中间结果) 在 init 时按实例分配, 推理时复用.
+//
+// Preprocessor 需要提供:
+//   int init(const cv::Size& inputSize);
+//   void* run(const cv::Mat& image, FrameContext& frame);    返回 NHWC RGB 输入缓冲区
+// Decoder 需要提供:
+//   static constexpr bool kWantFloat;                         输出是否由运行时转换为 float
+//   int init(const rknn_tensor_attr* outputAttrs, uint32_t outputNum, const FrameContext& frame);
+//   int decode(const rknn_output* outputs, const FrameContext& frame, ResultType& result);
+//                                                             result.detections 需由 decode 先清空再填写
+template <typename Preprocessor, typename Decoder, typename ResultType>
+class RknnModel : public BaseModel<ResultType> {
+public:
+    ~RknnModel() override;
+
+    // 初始化模型, shareFrom 为同一模型已初始化的上下文时与其共享权重
+    int init(const std::string& modelPath, rknn_context* shareFrom = nullptr) override;
+
+    // 获取 RKNN 上下文
+    rknn_context* get_rknn_context() override { return &this->ctx_; }
+
+    // 模型推理, 失败时也会发布一个空结果, 避免模型池任务一直等待
+    // 流水线模式下提交当前帧后返回, 发布的是上一帧的结果 (第一帧不发布)
+    int infer(const cv::Mat& inputData) override;
+
+    // 流水线模式下完成进行中的一帧并发布其结果
+    int flush() override;
+
+    // 获取检测结果
+    ResultType getResult() const { return result_; }
+
+protected:
+    // 查询模型输入输出属性
+    int queryAttributes();
+
+    // 从模型参数更新帧上下文
+    void prepareFrame(FrameContext& frame);
+
+    // 流水线模式的推理
+    int inferPipelined(const cv::Mat& inputData);
+
+    // 非阻塞提交一帧
+    void submit(void* input, const FrameContext& frame);
+
+    // 等待进行中的帧结束并取回输出
+    int collect();
+
+    // 解码 slot 中的帧并发布结果, ret 为之前步骤的返回值
+    int finish(int slot, int ret);
+
+    // 发布 pending_ 中的结果
+    void publish(bool ready);
+
+    // 流水线模式使用两组前处理缓冲区和帧上下文, 同步模式只使用第一组
+    // 输出在提交下一帧之前取回到预分配缓冲区, 解码期间 NPU 不会写入, 只需一组
+    Preprocessor preprocessors_[2];
+    FrameContext frames_[2];
+    Decoder decoder_;
+    ResultType result_;                               // 已发布的结果, 受 resultMtx_ 保护
+    ResultType pending_;                              // 正在解码的结果, 发布时与 result_ 交换以复用容量
+    std::vector<rknn_output> outputs_;                // 预分配的输出描述
+    std::vector<std::vector<uint8_t>> outputBuffers_; // 预分配的输出缓冲区
+    int slot_ = 0;                                    // 下一帧使用的缓冲区
+    bool inFlight_ = false;                           // 是否有已提交未取回的帧 (位于 slot_ ^ 1)
+    bool submitFailed_ = false;                       // 进行中的帧提交失败
+    rknn_run_extend runExtend_;                       // 进行中的帧的运行参数
+};
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+RknnModel<Preprocessor, Decoder, ResultType>::~RknnModel() {
+    // 安全销毁 RKNN 上下文, 先等待仍在 NPU 上的帧
+    if (this->ctx_ && inFlight_ && !submitFailed_) {
+        rknn_wait(this->ctx_, &runExtend_);
+    }
+    if (this->ctx_) {
+        rknn_destroy(this->ctx_);
+    }
+    // 安全释放输入输出属性
+    free(this->input_attrs_);
+    this->input_attrs_ = nullptr;
+    free(this->output_attrs_);
+    this->output_attrs_ = nullptr;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::queryAttributes() {
+    // 查询 SDK 版本信息
+    rknn_sdk_version version;
+    int ret = rknn_query(this->ctx_, RKNN_QUERY_SDK_VERSION, &version, sizeof(rknn_sdk_version));
+    if (ret < 0) {
+        std::cerr << "Failed to query SDK version, error code: " << ret << std::endl;
+        return -1;
+    }
+    std::cout << "SDK version: " << version.api_version << ", driver version: " << version.drv_version << std::endl;
+
+    // 获取模型输入输出参数
+    ret = rknn_query(this->ctx_, RKNN_QUERY_IN_OUT_NUM, &this->io_num_, sizeof(this->io_num_));
+    if (ret < 0) {
+        std::cerr << "Failed to query model I/O number, error code: " << ret << std::endl;
+        return -1;
+    }
+    std::cout << "Model input num: " << this->io_num_.n_input << ", output num: " << this->io_num_.n_output << std::endl;
+    if (this->io_num_.n_input < 1 || this->io_num_.n_output < 1) {
+        std::cerr << "Model has no inputs or outputs" << std::endl;
+        return -1;
+    }
+
+    // 分配并查询输入输出属性
+    this->input_attrs_ = static_cast<rknn_tensor_attr*>(calloc(this->io_num_.n_input, sizeof(rknn_tensor_attr)));
+    this->output_attrs_ = static_cast<rknn_tensor_attr*>(calloc(this->io_num_.n_output, sizeof(rknn_tensor_attr)));
+    if (!this->input_attrs_ || !this->output_attrs_) {
+        std::cerr << "Failed to allocate memory for tensor attributes." << std::endl;
+        return -1;
+    }
+    for (uint32_t i = 0; i < this->io_num_.n_input; i++) {
+        this->input_attrs_[i].index = i;
+        ret = rknn_query(this->ctx_, RKNN_QUERY_INPUT_ATTR, &this->input_attrs_[i], sizeof(rknn_tensor_attr));
+        if (ret < 0) {
+            std::cerr << "Failed to query input attribute for index " << i << ", error code: " << ret << std::endl;
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < this->io_num_.n_output; i++) {
+        this->output_attrs_[i].index = i;
+        ret = rknn_query(this->ctx_, RKNN_QUERY_OUTPUT_ATTR, &this->output_attrs_[i], sizeof(rknn_tensor_attr));
+        if (ret < 0) {
+            std::cerr << "Failed to query output attribute for index " << i << ", error code: " << ret << std::endl;
+            return -1;
+        }
+    }
+
+    // 确定输入格式及维度
+    const rknn_tensor_attr& input = this->input_attrs_[0];
+    if (input.fmt == RKNN_TENSOR_NCHW) {
+        std::cout << "Model input format: NCHW" << std::endl;
+        this->channel_ = input.dims[1];
+        this->height_ = input.dims[2];
+        this->width_ = input.dims[3];
+    } else {
+        std::cout << "Model input format: NHWC" << std::endl;
+        this->height_ = input.dims[1];
+        this->width_ = input.dims[2];
+        this->channel_ = input.dims[3];
+    }
+    std::cout << "Model input dimensions: height=" << this->height_ << ", width=" << this->width_
+              << ", channel=" << this->channel_ << std::endl;
+    return 0;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::init(const std::string& modelPath, rknn_context* shareFrom) {
+    std::cout << "Loading model " << modelPath << " ..." << std::endl;
+    this->modelPath_ = modelPath;
+
+    // 创建 RKNN 模型上下文, 同一模型池中的后续实例复制首个实例的上下文并共享权重
+    if (this->createContext(modelPath, shareFrom) < 0 || queryAttributes() < 0) {
+        return -1;
+    }
+
+    // 设置输入参数, 缓冲区在每帧前处理后指向前处理的输出
+    memset(this->inputs_, 0, sizeof(this->inputs_));
+    this->inputs_[0].index = 0;
+    this->inputs_[0].type = RKNN_TENSOR_UINT8;
+    this->inputs_[0].size = this->width_ * this->height_ * this->channel_;
+    this->inputs_[0].fmt = RKNN_TENSOR_NHWC;
+    this->inputs_[0].pass_through = 0;
+
+    // 输出缓冲区由实例持有, 运行时直接写入, 不在每帧分配和释放
+    outputs_.assign(this->io_num_.n_output, rknn_output());
+    outputBuffers_.resize(this->io_num_.n_output);
+    for (uint32_t i = 0; i < this->io_num_.n_output; i++) {
+        const rknn_tensor_attr& attr = this->output_attrs_[i];
+        outputBuffers_[i].assign(Decoder::kWantFloat ? attr.n_elems * sizeof(float) : attr.size, 0);
+        outputs_[i].index = i;
+        outputs_[i].want_float = Decoder::kWantFloat ? 1 : 0;
+        outputs_[i].is_prealloc = 1;
+        outputs_[i].buf = outputBuffers_[i].data();
+        outputs_[i].size = static_cast<uint32_t>(outputBuffers_[i].size());
+    }
+
+    const int slots = this->pipelined_ ? 2 : 1;
+    for (int i = 0; i < slots; i++) {
+        frames_[i].inputSize = cv::Size(this->width_, this->height_);
+        prepareFrame(frames_[i]);
+        if (preprocessors_[i].init(frames_[i].inputSize) < 0) {
+            std::cerr << "Failed to prepare preprocessing for " << modelPath << std::endl;
+            return -1;
+        }
+    }
+    if (decoder_.init(this->output_attrs_, this->io_num_.n_output, frames_[0]) < 0) {
+        std::cerr << "Failed to prepare postprocessing for " << modelPath << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+void RknnModel<Preprocessor, Decoder, ResultType>::prepareFrame(FrameContext& frame) {
+    frame.boxThreshold = this->box_conf_threshold_;
+    frame.nmsThreshold = this->nms_threshold_;
+    frame.warmingUp = this->warmingUp_;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::infer(const cv::Mat& inputData) {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    if (this->pipelined_) {
+        return inferPipelined(inputData);
+    }
+    FrameContext& frame = frames_[0];
+    prepareFrame(frame);
+    this->inputs_[0].buf = preprocessors_[0].run(inputData, frame);
+    this->img_width_ = frame.srcSize.width;
+    this->img_height_ = frame.srcSize.height;
+
+    int ret = rknn_inputs_set(this->ctx_, this->io_num_.n_input, this->inputs_);
+    if (ret != RKNN_SUCC) {
+        std::cerr << "rknn_inputs_set failed! ret=" << ret << std::endl;
+        publish(false);
+        return -1;
+    }
+    if ((ret = rknn_run(this->ctx_, nullptr)) != RKNN_SUCC) {
+        std::cerr << "rknn_run failed! ret=" << ret << std::endl;
+        publish(false);
+        return -1;
+    }
+    if ((ret = rknn_outputs_get(this->ctx_, this->io_num_.n_output, outputs_.data(), nullptr)) != RKNN_SUCC) {
+        std::cerr << "rknn_outputs_get failed! ret=" << ret << std::endl;
+        publish(false);
+        return -1;
+    }
+
+    ret = decoder_.decode(outputs_.data(), frame, pending_);
+    rknn_outputs_release(this->ctx_, this->io_num_.n_output, outputs_.data());
+    publish(ret == 0);
+    return ret == 0 ? 0 : -1;
+}
+
+// 流水线: 第 N-1 帧在 NPU 上时预处理第 N 帧, 取回第 N-1 帧输出并提交第 N 帧后,
+// 在第 N 帧运行期间解码第 N-1 帧; CPU 和 NPU 交替工作, 每个上下文的吞吐量接近纯 NPU 耗时
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::inferPipelined(const cv::Mat& inputData) {
+    FrameContext& frame = frames_[slot_];
+    prepareFrame(frame);
+    void* input = preprocessors_[slot_].run(inputData, frame);
+
+    bool hasPrevious = inFlight_;
+    int previousSlot = slot_ ^ 1;
+    int ret = hasPrevious ? collect() : 0;
+
+    submit(input, frame);
+    slot_ ^= 1;
+    return hasPrevious ? finish(previousSlot, ret) : 0;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::flush() {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    if (!inFlight_) {
+        return 0;
+    }
+    int ret = collect();
+    return finish(slot_ ^ 1, ret);
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+void RknnModel<Preprocessor, Decoder, ResultType>::submit(void* input, const FrameContext& frame) {
+    this->inputs_[0].buf = input;
+    this->img_width_ = frame.srcSize.width;
+    this->img_height_ = frame.srcSize.height;
+    int ret = rknn_inputs_set(this->ctx_, this->io_num_.n_input, this->inputs_);
+    if (ret != RKNN_SUCC) {
+        std::cerr << "rknn_inputs_set failed! ret=" << ret << std::endl;
+    } else {
+        memset(&runExtend_, 0, sizeof(runExtend_));
+        runExtend_.non_block = 1;
+        if ((ret = rknn_run(this->ctx_, &runExtend_)) != RKNN_SUCC) {
+            std::cerr << "rknn_run failed! ret=" << ret << std::endl;
+        }
+    }
+    // 提交失败的帧同样占用流水线的一个位置, 在下一次取回时发布空结果, 保证每帧恰好发布一次
+    inFlight_ = true;
+    submitFailed_ = ret != RKNN_SUCC;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::collect() {
+    inFlight_ = false;
+    if (submitFailed_) {
+        return -1;
+    }
+    int ret = rknn_wait(this->ctx_, &runExtend_);
+    if (ret != RKNN_SUCC) {
+        std::cerr << "rknn_wait failed! ret=" << ret << std::endl;
+        return -1;
+    }
+    if ((ret = rknn_outputs_get(this->ctx_, this->io_num_.n_output, outputs_.data(), nullptr)) != RKNN_SUCC) {
+        std::cerr << "rknn_outputs_get failed! ret=" << ret << std::endl;
+        return -1;
+    }
+    // 输出已写入预分配缓冲区, 先释放再提交下一帧
+    rknn_outputs_release(this->ctx_, this->io_num_.n_output, outputs_.data());
+    return 0;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+int RknnModel<Preprocessor, Decoder, ResultType>::finish(int slot, int ret) {
+    if (ret == 0) {
+        ret = decoder_.decode(outputs_.data(), frames_[slot], pending_);
+    }
+    publish(ret == 0);
+    return ret == 0 ? 0 : -1;
+}
+
+template <typename Preprocessor, typename Decoder, typename ResultType>
+void RknnModel<Preprocessor, Decoder, ResultType>::publish(bool ready) {
+    if (!ready) {
+        pending_.detections.clear();
+    }
+    std::lock_guard<std::mutex> lock(this->resultMtx_);
+    result_.detections.swap(pending_.detections);
+    result_.ready_ = ready;
+    this->dataReady_ = true;            // 标记数据已更新
+    this->cv_.notify_one();             // 通知等待的线程有新数据
+}
+
+#endif // RKNNMODEL_H
@@ -2,10 +2,19 @@
 #define RKNNPOOL_H
 
 #include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
 #include <queue>
 #include <memory>
+#include <functional>
 #include <future>
+#include <vector>
 #include "MutexQueue.h"
+#include "BaseModel.h"
+#include "ModelBlob.h"
+#include "FileUtils.h"
+#include "Metrics.h"
+#include "ReplayBench.h"
 
 // using DetectionResult = std::variant<PerDetResult, PerAttrResult, FallDetResult, FireSmokeDetResult>;
 
@@ -13,14 +22,61 @@
 template <typename rknnModel, typename inputType, typename resultType>
 class rknnPool {
 private:
+    // 每个实例的任务槽: 同一实例上的推理和取结果串行执行;
+    // 流水线模式下记录已提交、结果尚未发布的帧
+    struct Slot {
+        std::mutex mtx;
+        bool pending = false;                                // 是否有结果未发布的帧
+        uint64_t frameID = 0, ID = 0;                        // 该帧的帧ID和目标ID
+    };
+
+    // 一组模型实例 (一代), 重新加载时整体替换
+    // 推理任务开始时取得当前一代的引用, 旧的一代在进行中的任务全部结束后随最后一个引用释放
+    struct Instances {
+        std::string modelPath;                               // 模型路径
+        std::vector<std::shared_ptr<rknnModel>> models;      // 模型实例集合
+        std::vector<ModelInitTiming> timings;                // 各实例初始化耗时
+        std::vector<std::unique_ptr<Slot>> slots;            // 各实例的任务槽
+
+        // 按创建的逆序销毁, 复制出的上下文先于原始上下文释放
+        ~Instances() {
+            while (!models.empty()) {
+                models.pop_back();
+            }
+        }
+    };
+
     int threadNum_;                                      // 线程数量
-    std::string modelPath_;                              // 模型路径
     long long id_;                                       // 任务ID计数器
-    std::mutex idMtx_, queueMtx_;                        // 线程安全的互斥锁
+    std::mutex idMtx_, queueMtx_, reloadMtx_;            // 线程安全的互斥锁
     std::unique_ptr<dpool::ThreadPool> pool_;            // 线程池实例
     std::queue<std::future<void>> futs_;                 // 存储推理结果的future队列
-    std::vector<std::shared_ptr<rknnModel>> models_;     // 模型实例集合
+    std::shared_ptr<Instances> instances_;               // 当前一代实例, 通过 std::atomic_load/atomic_store 访问
+    std::string initialPath_;                            // 构造时的模型路径, 首次 init 使用
     MutexQueue& resultQueue_;          // 结果队列引用
+    std::string inferMetric_;                            // 推理耗时指标名
+    std::string benchStage_;                             // 基准测试中该模型的阶段名
+    std::atomic<bool> firstInferDone_{false};            // 是否已记录第一帧真实推理耗时
+    std::function<void(rknnModel&)> setup_;              // 实例创建后、init 之前的参数设置
+    cv::Size expectedInput_;                             // 期望的模型输入尺寸, 0x0 表示不检查
+    std::atomic<int> outstanding_{0};                    // 已提交未结束的推理任务数
+
+    // 创建并初始化一代实例, 首个实例之后的实例并行初始化
+    int build(Instances& instances, const std::string& modelPath);
+
+    // 初始化第 index 个实例
+    int initInstance(Instances& instances, int index, rknn_context* shareFrom);
+
+    // 用合成帧预热一代实例
+    int warmupInstances(Instances& instances, const cv::Size& frameSize, int iterations);
+
+    std::shared_ptr<Instances> current() const { return std::atomic_load(&instances_); }
+
+    // 等待实例发布结果并写入结果队列
+    void emit(rknnModel& model, uint64_t frameID, uint64_t ID);
+
+    // 完成一代实例中流水线上所有未发布的帧
+    void flushInstances(Instances& instances);
 
 protected:
     // 获取模型ID，用于调度模型
@@ -31,9 +87,30 @@ public:
     rknnPool(const std::string& modelPath, int threadNum, MutexQueue& resultQueue);
     // rknnPool(const std::string& modelPath, int threadNum, ResultQueue<DetectionResult>& resultQueue);
 
-    // 初始化每个模型实例
+    // 初始化每个模型实例, 首个实例之后的实例并行初始化
     int init();
 
+    // 每个实例用 frameSize 大小的合成帧推理 iterations 次, 第一次为冷启动, 其余为稳态
+    int warmup(const cv::Size& frameSize, int iterations = 3);
+
+    // 重新加载: 在调用线程中按 modelPath 创建并预热新的一代实例, 成功后在任务之间原子替换,
+    // 期间推理继续使用旧实例; 失败时保留旧实例. 实例数不变
+    int reload(const std::string& modelPath, const cv::Size& frameSize, int iterations = 3);
+
+    // 设置每个实例的参数 (阈值等), 在 init 和 reload 中对每个新建实例调用
+    void setModelSetup(std::function<void(rknnModel&)> setup);
+
+    // 期望的模型输入尺寸, init 和 reload 时与模型文件不符则失败
+    void setExpectedInputSize(const cv::Size& size) { expectedInput_ = size; }
+
+    std::string modelPath() const;
+
+    // 模型输入尺寸, init 成功后有效
+    cv::Size inputSize() const;
+
+    // 当前一代各实例的分段耗时
+    std::vector<ModelInitTiming> initTimings() const;
+
     // 模型推理：将输入数据放入线程池进行处理
     int put(inputType inputData, uint64_t frameID, uint64_t ID = 0);
 
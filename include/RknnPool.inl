@@ -1,56 +1,294 @@
 template <typename rknnModel, typename inputType, typename resultType>
 rknnPool<rknnModel, inputType, resultType>::rknnPool(const std::string& modelPath, int threadNum, MutexQueue& resultQueue)
-    : modelPath_(modelPath), threadNum_(threadNum), resultQueue_(resultQueue), id_(0){
+    : threadNum_(threadNum), id_(0), initialPath_(modelPath), resultQueue_(resultQueue) {
     pool_ = std::make_unique<dpool::ThreadPool>(threadNum);
+    // infer.<模型文件名>_ms, 重新加载后保持不变
+    std::string name = modelPath.substr(modelPath.find_last_of('/') + 1);
+    inferMetric_ = "infer." + name.substr(0, name.find('.')) + "_ms";
+    benchStage_ = "infer." + name.substr(0, name.find('.'));
 }
 
 template <typename rknnModel, typename inputType, typename resultType>
-int rknnPool<rknnModel, inputType, resultType>::init() {
+int rknnPool<rknnModel, inputType, resultType>::initInstance(Instances& instances, int index, rknn_context* shareFrom) {
+    std::cout << "rknnpool init" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    int ret = instances.models[index]->init(instances.modelPath, shareFrom);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    instances.timings[index] = instances.models[index]->initTiming();
+    instances.timings[index].totalMs = elapsed.count();
+    if (ret != 0) {
+        std::cerr << "Model initialization failed for thread " << index << std::endl;
+        return -1;
+    }
+    Metrics::instance().observe(index == 0 ? "model.init_ms" : "model.dup_ms", elapsed.count());
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+int rknnPool<rknnModel, inputType, resultType>::build(Instances& instances, const std::string& modelPath) {
+    long rssBeforeKb = resident_kb();
+    auto poolStart = std::chrono::steady_clock::now();
+    // 初始化期间持有模型映射, 需要完整初始化的实例共用同一份映射
+    std::shared_ptr<const ModelBlob> blob = ModelBlob::open(modelPath);
+    std::chrono::duration<double, std::milli> loadElapsed = std::chrono::steady_clock::now() - poolStart;
+
+    instances.modelPath = modelPath;
+    instances.timings.assign(threadNum_, ModelInitTiming());
     for (int i = 0; i < threadNum_; ++i) {
-        auto model = std::make_shared<rknnModel>();
-        std::cout << "rknnpool init" << std::endl;
-        if (model->init(modelPath_) != 0) {
-            std::cerr << "Model initialization failed for thread " << i << std::endl;
-            return -1;
+        instances.slots.push_back(std::make_unique<Slot>());
+        instances.models.push_back(std::make_shared<rknnModel>());
+        if (setup_) {
+            setup_(*instances.models.back());
         }
-        models_.push_back(model);
     }
+
+    // 第一个实例完整初始化, 其余实例在其完成后并行复制其上下文
+    int ret = initInstance(instances, 0, nullptr);
+    // 文件映射在池中完成, 计入首个实例
+    instances.timings[0].loadMs += loadElapsed.count();
+    instances.timings[0].totalMs += loadElapsed.count();
+    if (ret == 0 && threadNum_ > 1) {
+        rknn_context* shareFrom = instances.models.front()->get_rknn_context();
+        std::vector<std::future<int>> rets;
+        for (int i = 1; i < threadNum_; ++i) {
+            rets.push_back(std::async(std::launch::async, [this, &instances, i, shareFrom] {
+                return initInstance(instances, i, shareFrom);
+            }));
+        }
+        for (auto& r : rets) {
+            if (r.get() != 0) {
+                ret = -1;
+            }
+        }
+    }
+    blob.reset();
+    if (ret == 0 && expectedInput_.area() > 0 && instances.models.front()->inputSize() != expectedInput_) {
+        cv::Size actual = instances.models.front()->inputSize();
+        std::cerr << "Model " << modelPath << " input is " << actual.width << "x" << actual.height << ", config expects "
+                  << expectedInput_.width << "x" << expectedInput_.height << std::endl;
+        ret = -1;
+    }
+    if (ret != 0) {
+        // 逆序释放已创建的实例
+        while (!instances.models.empty()) {
+            instances.models.pop_back();
+        }
+        return -1;
+    }
+
+    std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - poolStart;
+    long rssAfterKb = resident_kb();
+    std::cout << "rknnpool " << modelPath << ": " << threadNum_ << " instance(s) in " << total.count() << " ms, RSS "
+              << rssBeforeKb / 1024.0 << " -> " << rssAfterKb / 1024.0 << " MB" << std::endl;
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+int rknnPool<rknnModel, inputType, resultType>::init() {
+    std::lock_guard<std::mutex> lock(reloadMtx_);
+    auto instances = std::make_shared<Instances>();
+    if (build(*instances, initialPath_) != 0) {
+        return -1;
+    }
+    std::atomic_store(&instances_, instances);
     return 0;
 }
 
+template <typename rknnModel, typename inputType, typename resultType>
+int rknnPool<rknnModel, inputType, resultType>::warmup(const cv::Size& frameSize, int iterations) {
+    std::lock_guard<std::mutex> lock(reloadMtx_);
+    std::shared_ptr<Instances> instances = current();
+    return instances ? warmupInstances(*instances, frameSize, iterations) : -1;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+int rknnPool<rknnModel, inputType, resultType>::warmupInstances(Instances& instances, const cv::Size& frameSize, int iterations) {
+    // 各实例上下文独立, 并行预热
+    std::vector<std::future<int>> rets;
+    for (size_t i = 0; i < instances.models.size(); ++i) {
+        rets.push_back(std::async(std::launch::async, [this, &instances, i, frameSize, iterations] {
+            cv::Mat input(frameSize, CV_8UC3, cv::Scalar(114, 114, 114));
+            std::vector<double> latencies;
+            int ret = instances.models[i]->warmup(input, iterations, latencies);
+            if (!latencies.empty()) {
+                instances.timings[i].warmupFirstMs = latencies.front();
+                Metrics::instance().observe("model.warmup_first_ms", latencies.front());
+            }
+            if (latencies.size() > 1) {
+                double sum = 0;
+                for (size_t k = 1; k < latencies.size(); ++k) {
+                    sum += latencies[k];
+                }
+                instances.timings[i].warmupSteadyMs = sum / (latencies.size() - 1);
+                Metrics::instance().observe("model.warmup_steady_ms", instances.timings[i].warmupSteadyMs);
+            }
+            if (ret != 0) {
+                std::cerr << "Warm-up failed for " << instances.modelPath << " instance " << i << std::endl;
+            }
+            return ret;
+        }));
+    }
+    int ret = 0;
+    for (auto& r : rets) {
+        if (r.get() != 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+int rknnPool<rknnModel, inputType, resultType>::reload(const std::string& modelPath, const cv::Size& frameSize, int iterations) {
+    std::lock_guard<std::mutex> lock(reloadMtx_);
+    auto start = std::chrono::steady_clock::now();
+    // 新旧两代实例在替换前同时存在, 需要额外一份模型内存
+    auto instances = std::make_shared<Instances>();
+    if (build(*instances, modelPath) != 0 || warmupInstances(*instances, frameSize, iterations) != 0) {
+        std::cerr << "Reload of " << modelPath << " failed, keeping the running instances" << std::endl;
+        Metrics::instance().add("model.reload_failures");
+        return -1;
+    }
+    // 之后开始的任务使用新实例, 旧实例由进行中的任务持有到结束
+    std::shared_ptr<Instances> retired = std::atomic_exchange(&instances_, instances);
+    long inFlight = retired ? retired.use_count() - 1 : 0;
+    if (retired) {
+        // 旧实例流水线上的帧不会再有后续帧推动, 在这里完成; 之后才结束的任务自行完成
+        flushInstances(*retired);
+    }
+    retired.reset();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "rknnpool " << modelPath << ": reloaded in " << elapsed.count() << " ms, " << inFlight
+              << " task(s) still on the previous instances" << std::endl;
+    Metrics::instance().add("model.reloads");
+    Metrics::instance().observe("model.reload_ms", elapsed.count());
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+void rknnPool<rknnModel, inputType, resultType>::setModelSetup(std::function<void(rknnModel&)> setup) {
+    std::lock_guard<std::mutex> lock(reloadMtx_);
+    setup_ = std::move(setup);
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+std::string rknnPool<rknnModel, inputType, resultType>::modelPath() const {
+    std::shared_ptr<Instances> instances = current();
+    return instances ? instances->modelPath : initialPath_;
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+cv::Size rknnPool<rknnModel, inputType, resultType>::inputSize() const {
+    std::shared_ptr<Instances> instances = current();
+    return instances && !instances->models.empty() ? instances->models.front()->inputSize() : cv::Size();
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+std::vector<ModelInitTiming> rknnPool<rknnModel, inputType, resultType>::initTimings() const {
+    std::shared_ptr<Instances> instances = current();
+    return instances ? instances->timings : std::vector<ModelInitTiming>();
+}
+
 template <typename rknnModel, typename inputType, typename resultType>
 int rknnPool<rknnModel, inputType, resultType>::getModelId() {
     std::lock_guard<std::mutex> lock(idMtx_);
     return id_++ % threadNum_;
 }
 
+template <typename rknnModel, typename inputType, typename resultType>
+void rknnPool<rknnModel, inputType, resultType>::emit(rknnModel& model, uint64_t frameID, uint64_t ID) {
+    // 等待数据更新
+    resultType result;
+    {
+        std::unique_lock<std::mutex> resultLock(model.resultMtx_); // 使用 resultMtx_ 锁
+        model.cv_.wait(resultLock, [&model] { return model.dataReady_; });
+
+        // 重置数据状态
+        model.dataReady_ = false;
+
+        // 获取结果
+        result = model.getResult(); // 在锁的作用域内获取结果
+    }
+
+    // 先记录完成时间再发布, 汇总线程取到这一帧时完成时间已经记录
+    if (ReplayBench::instance().enabled()) {
+        ReplayBench::instance().inferFinished(frameID);
+    }
+    // 将帧ID存储到结果中
+    resultQueue_.setResult(frameID, result, ID);
+}
+
+template <typename rknnModel, typename inputType, typename resultType>
+void rknnPool<rknnModel, inputType, resultType>::flushInstances(Instances& instances) {
+    for (size_t i = 0; i < instances.models.size(); ++i) {
+        Slot& slot = *instances.slots[i];
+        std::lock_guard<std::mutex> slotLock(slot.mtx);
+        if (slot.pending) {
+            instances.models[i]->flush();
+            emit(*instances.models[i], slot.frameID, slot.ID);
+            slot.pending = false;
+        }
+    }
+}
+
 template <typename rknnModel, typename inputType, typename resultType>
 int rknnPool<rknnModel, inputType, resultType>::put(inputType inputData, uint64_t frameID, uint64_t ID) {
     std::lock_guard<std::mutex> lock(queueMtx_); // 确保对 futs_ 的安全访问
+    ++outstanding_;
     futs_.push(pool_->submit([this, inputData, frameID, ID]() {
+        // 整个任务使用同一代实例, 重新加载不会打断进行中的推理
+        std::shared_ptr<Instances> instances = this->current();
         // 获取当前模型ID
         int modelId = this->getModelId();
-        auto& model = models_[modelId];
-
-        // 调用 infer 方法进行推理
-        model->infer(inputData);
+        auto& model = instances->models[modelId];
+        Slot& slot = *instances->slots[modelId];
+        // 基准测试在任务内计时, 包括 NPU 推理、解码和发布, 以及本线程的 CPU 时间
+        ReplayBench& bench = ReplayBench::instance();
+        double cpuMs = bench.enabled() ? ReplayBench::threadCpuMs() : 0.0;
+        std::chrono::steady_clock::time_point start;
 
-        // 等待数据更新
-        resultType result;
         {
-            std::unique_lock<std::mutex> resultLock(model->resultMtx_); // 使用 resultMtx_ 锁
-            model->cv_.wait(resultLock, [model] { return model->dataReady_; });
-            // model->cv_.wait_for(resultLock, std::chrono::milliseconds(1000), [model] { return model->dataReady_; });
+            std::lock_guard<std::mutex> slotLock(slot.mtx);
+            if (bench.enabled()) {
+                bench.inferStarted(frameID);
+            }
+            // 调用 infer 方法进行推理
+            start = std::chrono::steady_clock::now();
+            model->infer(inputData);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            Metrics::instance().observe(inferMetric_, elapsed.count());
+            if (!firstInferDone_.exchange(true)) {
+                std::cout << "\n" << instances->modelPath << ": first frame infer " << elapsed.count() << " ms" << std::endl;
+            }
 
-            // 重置数据状态
-            model->dataReady_ = false;
-
-            // 获取结果
-            result = model->getResult(); // 在锁的作用域内获取结果
+            if (!model->pipelined()) {
+                emit(*model, frameID, ID);
+            } else {
+                // 流水线模式下本次发布的是该实例上一帧的结果, 本帧的结果由下一次推理或 flush 发布
+                if (slot.pending) {
+                    emit(*model, slot.frameID, slot.ID);
+                }
+                slot.pending = true;
+                slot.frameID = frameID;
+                slot.ID = ID;
+            }
         }
 
-        // 将帧ID存储到结果中
-        resultQueue_.setResult(frameID, result, ID);
+        // 没有后续任务时完成流水线上的帧, 避免结果滞留到下一帧到来; 持续有帧时流水线保持填满
+        // 实例已被替换时, 旧实例上的帧也在这里完成
+        bool idle = --outstanding_ == 0;
+        std::shared_ptr<Instances> latest = this->current();
+        if (latest != instances) {
+            flushInstances(*instances);
+        }
+        if (idle && latest) {
+            flushInstances(*latest);
+        }
+        if (bench.enabled()) {
+            std::chrono::duration<double, std::milli> taskElapsed = std::chrono::steady_clock::now() - start;
+            bench.observe(benchStage_, taskElapsed.count());
+            bench.chargeCpu(benchStage_, cpuMs);
+        }
     }));
 
     return 0;
@@ -69,5 +307,7 @@ int rknnPool<rknnModel, inputType, resultType>::put(inputType inputData, uint64_
 
 template <typename rknnModel, typename inputType, typename resultType>
 rknnPool<rknnModel, inputType, resultType>::~rknnPool() {
-    // pool.reset();
+    // 先等待线程池中的任务结束, 再释放实例
+    pool_.reset();
+    std::atomic_store(&instances_, std::shared_ptr<Instances>());
 }
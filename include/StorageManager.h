@@ -0,0 +1,89 @@
+#ifndef STORAGEMANAGER_H
+#define STORAGEMANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class DatabaseManager;
+
+// 输出目录存储管理
+// 结果文件按 <root>/<类别>/<YYYYMMDD>/<HH>/ 分片保存, 每个小时目录只包含该小时的文件,
+// 后台低优先级线程维护各分片的大小, 超过保留天数或磁盘配额时按时间从旧到新整目录删除,
+// 并定期通知数据库删除过期记录. 启动后只扫描仍在写入的分片, 不再遍历整个输出目录
+class StorageManager {
+public:
+    // quotaBytes 为 0 表示不限配额, retentionDays 为 0 表示不按时间清理
+    StorageManager(const std::string& root = "output", uint64_t quotaBytes = 4ULL << 30, int retentionDays = 30,
+                   int scanIntervalMs = 60000);
+
+    ~StorageManager();
+
+    // 登记受管理的类别, 需在 start 之前调用
+    void addCategory(const std::string& category);
+
+    // 数据库保留天数, rollupRetentionDays 只作用于分钟汇总, 0 表示不清理数据库
+    void setDatabase(DatabaseManager* db, int retentionDays, int rollupRetentionDays);
+
+    void setQuota(uint64_t quotaBytes) { quotaBytes_ = quotaBytes; }
+    void setRetentionDays(int days) { retentionDays_ = days; }
+
+    // 扫描已有分片并启动后台线程
+    int start();
+    void stop();
+
+    // 返回输出文件路径 (不含扩展名) 并确保所在的小时目录存在
+    // 文件名带帧ID, 同一秒内的多帧不会互相覆盖
+    std::string pathFor(const std::string& category, int64_t timestampMs, uint64_t frameID);
+
+    // 返回时间所在的小时目录并确保其存在, 供自行命名文件的模块 (检测日志、事件片段) 使用
+    std::string dirFor(const std::string& category, int64_t timestampMs);
+
+    uint64_t usedBytes() const { return usedBytes_; }
+
+private:
+    // 分片键: (YYYYMMDDHH, 类别); 旧版平铺在类别目录下的文件记为小时 0, 最先被删除
+    using ShardKey = std::pair<int64_t, std::string>;
+    struct Shard {
+        uint64_t bytes = 0;
+        uint64_t files = 0;
+        bool sealed = false;      // 该小时已过去足够久, 不会再有新文件, 不再重新统计
+    };
+
+    void scanAll();
+    void measure(const ShardKey& key, Shard& shard);
+    void evict(int64_t nowMs);
+    void removeShard(const ShardKey& key);
+    void pruneDatabase(int64_t nowMs);
+    void run();
+    std::string shardDir(const ShardKey& key) const;
+
+    std::string root_;
+    std::atomic<uint64_t> quotaBytes_;
+    std::atomic<int> retentionDays_;
+    int scanIntervalMs_;
+
+    DatabaseManager* db_ = nullptr;
+    int dbRetentionDays_ = 0;
+    int rollupRetentionDays_ = 0;
+    int64_t lastPruneMs_ = 0;
+
+    std::vector<std::string> categories_;
+    std::map<ShardKey, Shard> shards_;              // 只在后台线程中访问
+    std::atomic<uint64_t> usedBytes_{0};
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::map<std::string, int64_t> currentHour_;   // 每个类别最近一次创建的小时目录
+    std::vector<ShardKey> newShards_;              // pathFor 新建的分片, 等待后台线程接管
+    bool quit_ = false;
+    std::thread worker_;
+};
+
+#endif // STORAGEMANAGER_H
@@ -0,0 +1,137 @@
+#ifndef TRACKSTATEMAP_H
+#define TRACKSTATEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 以跟踪 ID 为键的定长开放寻址哈希表 (线性探测, 删除时后移回填),
+// 容量固定为 2 的幂, 运行期间不再分配内存
+template <typename ValueType>
+class TrackStateMap {
+public:
+    explicit TrackStateMap(size_t capacity = 1024) {
+        size_t cap = 16;
+        while (cap < capacity + 1) {
+            cap <<= 1;
+        }
+        slots_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    // 查找键, 不存在时返回 nullptr
+    ValueType* find(uint64_t key) {
+        for (size_t i = home(key), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+            if (!slots_[i].used) {
+                return nullptr;
+            }
+            if (slots_[i].key == key) {
+                return &slots_[i].value;
+            }
+        }
+        return nullptr;
+    }
+
+    // 插入或获取键对应的值, 新插入的值为默认值; 表满时返回 nullptr
+    ValueType* insert(uint64_t key, bool* inserted = nullptr) {
+        for (size_t i = home(key), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+            if (!slots_[i].used) {
+                if (size_ == mask_) {
+                    break; // 至少保留一个空槽, 保证查找可以终止
+                }
+                slots_[i].used = true;
+                slots_[i].key = key;
+                slots_[i].value = ValueType();
+                size_++;
+                if (inserted) *inserted = true;
+                return &slots_[i].value;
+            }
+            if (slots_[i].key == key) {
+                if (inserted) *inserted = false;
+                return &slots_[i].value;
+            }
+        }
+        if (inserted) *inserted = false;
+        return nullptr;
+    }
+
+    void erase(uint64_t key) {
+        for (size_t i = home(key), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+            if (!slots_[i].used) {
+                return;
+            }
+            if (slots_[i].key == key) {
+                eraseSlot(i);
+                return;
+            }
+        }
+    }
+
+    // 删除满足条件的所有元素, pred(key, value) 返回 true 表示删除
+    template <typename Pred>
+    void eraseIf(Pred pred) {
+        for (size_t i = 0; i <= mask_;) {
+            if (slots_[i].used && pred(slots_[i].key, slots_[i].value)) {
+                eraseSlot(i); // 后移回填的元素落在 i 上, 需要重新检查
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    template <typename Func>
+    void forEach(Func func) {
+        for (auto& slot : slots_) {
+            if (slot.used) {
+                func(slot.key, slot.value);
+            }
+        }
+    }
+
+    void clear() {
+        for (auto& slot : slots_) {
+            slot.used = false;
+        }
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return mask_; }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        bool used = false;
+        ValueType value{};
+    };
+
+    size_t home(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+    }
+
+    // 删除槽位 i, 并把后续探测链上的元素前移, 避免墓碑
+    void eraseSlot(size_t i) {
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask_;
+            if (!slots_[j].used) {
+                break;
+            }
+            size_t k = home(slots_[j].key);
+            // k 不在 (i, j] 区间内时, 元素 j 可以前移到 i
+            bool between = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+            if (!between) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i].used = false;
+        size_--;
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // TRACKSTATEMAP_H
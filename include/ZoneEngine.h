@@ -0,0 +1,42 @@
+#ifndef ZONEENGINE_H
+#define ZONEENGINE_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// 区域定义, 多边形可以是凹多边形
+struct Zone {
+    std::string name;                // 区域名称
+    std::vector<cv::Point> polygon;  // 多边形顶点 (原图像素坐标)
+};
+
+// 区域判定引擎: 启动时把所有多边形栅格化为低分辨率网格, 并为每个区域生成积分图,
+// 之后任意检测框与任意区域的重叠判定都是 O(1)
+class ZoneEngine {
+public:
+    explicit ZoneEngine(int cellSize = 8);
+
+    // 栅格化区域, 只需在启动或配置变化时调用
+    void build(const std::vector<Zone>& zones);
+
+    // 检测框是否与第 zoneIdx 个区域重叠
+    bool overlaps(size_t zoneIdx, const cv::Rect_<float>& box) const;
+
+    // 统计每个区域内的检测框数量, counts 大小会被调整为区域数量
+    void count(const std::vector<cv::Rect_<float>>& boxes, std::vector<int>& counts) const;
+
+    const std::vector<Zone>& zones() const { return zones_; }
+    size_t size() const { return zones_.size(); }
+
+private:
+    // 将检测框转换为网格坐标范围, 完全在网格外时返回 false
+    bool toCells(const cv::Rect_<float>& box, int& x0, int& y0, int& x1, int& y1) const;
+
+    int cellSize_;                   // 网格大小 (像素)
+    int gridW_, gridH_;              // 网格宽高
+    std::vector<Zone> zones_;        // 区域定义
+    std::vector<cv::Mat> integrals_; // 每个区域的积分图, CV_32S, (gridH_ + 1) x (gridW_ + 1)
+};
+
+#endif // ZONEENGINE_H
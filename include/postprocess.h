@@ -35,6 +35,10 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
                  std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
                  detect_result_group_t *group);
 
+// 加载类别标签, 可重复调用, 只在第一次成功时读文件
+// labelsPath 为空时使用相对当前目录的 ./model/coco_80_labels_list.txt
+int initPostProcess(const char *labelsPath = nullptr);
+
 void deinitPostProcess();
 
 #endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_H_
@@ -24,11 +24,22 @@ typedef struct TrackingBox
     cv::Rect_<float> box;
 }TrackingBox;
 
+typedef struct TrackingStats
+{
+    uint64_t frames;                // Update 调用次数
+    uint64_t tracks_created;        // 新建轨迹数 (ID 切换次数的上界)
+    uint64_t low_score_matches;     // 二次关联中由低分检测维持住的轨迹次数
+}TrackingStats;
+
 
 class TrackingSession {
     public:
         virtual ~TrackingSession() {};
         virtual std::vector<TrackingBox> Update(const std::vector<DetectionBox> &dets) = 0;
+        // ByteTrack 风格的二次关联: score >= high_score_threshold 的检测参与第一次关联并可新建轨迹,
+        // 其余低分检测只与第一次未匹配的轨迹做关联, 不会新建轨迹. high_score_threshold <= 0 时关闭.
+        virtual void SetLowScoreAssociation(float high_score_threshold, float low_iou_threshold) = 0;
+        virtual TrackingStats GetStats() const = 0;
 };
 
 #ifdef __cplusplus
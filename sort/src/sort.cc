@@ -28,15 +28,23 @@ public:
         m_max_age(max_age), m_min_hits(min_hits), m_iou_threshold(iou_threshold) {
         m_frame_count = 0;
         m_trackers = {};
+        m_high_score_threshold = 0.f;
+        m_low_iou_threshold = iou_threshold;
+        m_stats = {};
         ms_num_session++;
     }
     std::vector<TrackingBox> Update(const std::vector<DetectionBox> &dets) override;
+    void SetLowScoreAssociation(float high_score_threshold, float low_iou_threshold) override;
+    TrackingStats GetStats() const override { return m_stats; }
     ~Sort() { ms_num_session--; };
 
 private:
     float m_iou_threshold;
+    // may be changed by SetLowScoreAssociation while another thread is in Update (model reload)
+    std::atomic<float> m_high_score_threshold, m_low_iou_threshold;
     int m_max_age, m_min_hits, m_frame_count;
     std::vector<KalmanTracker> m_trackers;
+    TrackingStats m_stats;
 
     static std::atomic<int> ms_num_session;
 };
@@ -76,6 +84,12 @@ static void AssociateDetectionsToTrackers(const std::vector<DetectionBox> &dets,
         return;
     }
 
+    if (det_num == 0) {
+        for (int i = 0; i < trk_num; i++)
+            unmatched_trackers.push_back(i);
+        return;
+    }
+
     std::vector<std::vector<double>> iou_matrix(det_num, std::vector<double>(trk_num, 0));
 
     for (int i = 0; i < det_num; i++)
@@ -111,9 +125,15 @@ static void AssociateDetectionsToTrackers(const std::vector<DetectionBox> &dets,
     }
 }
 
+void Sort::SetLowScoreAssociation(float high_score_threshold, float low_iou_threshold) {
+    m_high_score_threshold = high_score_threshold;
+    m_low_iou_threshold = low_iou_threshold;
+}
+
 std::vector<TrackingBox> Sort::Update(const std::vector<DetectionBox> &dets)
 {
     m_frame_count += 1;
+    m_stats.frames += 1;
     std::vector<TrackingBox> trks;
 
     for(auto it = m_trackers.begin(); it != m_trackers.end();) {
@@ -128,24 +148,55 @@ std::vector<TrackingBox> Sort::Update(const std::vector<DetectionBox> &dets)
         }
     }
 
+    // split detections by score, low-score ones are only used to keep existing tracks alive
+    const float high_score_threshold = m_high_score_threshold;
+    const float low_iou_threshold = m_low_iou_threshold;
+    std::vector<DetectionBox> high_dets, low_dets;
+    if (high_score_threshold > 0) {
+        for (const auto &d : dets) {
+            if (d.score >= high_score_threshold)
+                high_dets.push_back(d);
+            else
+                low_dets.push_back(d);
+        }
+    }
+    const std::vector<DetectionBox> &first_dets = high_score_threshold > 0 ? high_dets : dets;
+
     std::vector<std::vector<int>> matches;
     std::vector<int> unmatched_detections, unmatched_trackers;
 
-    AssociateDetectionsToTrackers(dets, trks, m_iou_threshold, matches, unmatched_detections, unmatched_trackers);
+    AssociateDetectionsToTrackers(first_dets, trks, m_iou_threshold, matches, unmatched_detections, unmatched_trackers);
 
     // update matched trackers with assigned detections.
     for (const auto &m : matches) {
-        if (m[1] < m_trackers.size() && m[0] < dets.size()) {
-            m_trackers[m[1]].Update(dets[m[0]].box);
+        if (m[1] < m_trackers.size() && m[0] < first_dets.size()) {
+            m_trackers[m[1]].Update(first_dets[m[0]].box);
         } else {
             std::cerr << "Index out of bounds: m[0] = " << m[0] << ", m[1] = " << m[1] << std::endl;
         }
     }
 
+    // second association: remaining trackers against low-score detections
+    if (!low_dets.empty() && !unmatched_trackers.empty()) {
+        std::vector<TrackingBox> left_trks;
+        for (int t : unmatched_trackers)
+            left_trks.push_back(trks[t]);
+
+        std::vector<std::vector<int>> low_matches;
+        std::vector<int> low_unmatched_dets, low_unmatched_trks;
+        AssociateDetectionsToTrackers(low_dets, left_trks, low_iou_threshold, low_matches, low_unmatched_dets, low_unmatched_trks);
+
+        for (const auto &m : low_matches) {
+            m_trackers[unmatched_trackers[m[1]]].Update(low_dets[m[0]].box);
+            m_stats.low_score_matches += 1;
+        }
+    }
+
     // create and initialise new trackers for unmatched detections
     for(auto &d : unmatched_detections) {
-        KalmanTracker tracker = KalmanTracker(dets[d].box);
+        KalmanTracker tracker = KalmanTracker(first_dets[d].box);
         m_trackers.push_back(tracker);
+        m_stats.tracks_created += 1;
     }
 
     trks.clear();
@@ -0,0 +1,369 @@
+#include "AppConfig.h"
+#include <cmath>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <json/json.h>
+
+namespace {
+
+// 检查对象中未知的键, 只告警不报错, 便于发现拼写错误
+void warnUnknownKeys(const Json::Value& obj, const std::string& where, std::initializer_list<const char*> known) {
+    for (const auto& key : obj.getMemberNames()) {
+        bool found = false;
+        for (const char* name : known) {
+            if (key == name) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            std::cerr << "Config: unknown key " << where << "." << key << ", ignored" << std::endl;
+        }
+    }
+}
+
+bool readInt(const Json::Value& obj, const char* key, const std::string& where, int64_t minValue, int64_t& out) {
+    if (!obj.isMember(key)) {
+        return true;
+    }
+    const Json::Value& value = obj[key];
+    if (!value.isIntegral() || value.asInt64() < minValue) {
+        std::cerr << "Config: " << where << "." << key << " must be an integer >= " << minValue << std::endl;
+        return false;
+    }
+    out = value.asInt64();
+    return true;
+}
+
+bool readInt(const Json::Value& obj, const char* key, const std::string& where, int minValue, int& out) {
+    int64_t value = out;
+    if (!readInt(obj, key, where, static_cast<int64_t>(minValue), value)) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+bool readBool(const Json::Value& obj, const char* key, const std::string& where, bool& out) {
+    if (!obj.isMember(key)) {
+        return true;
+    }
+    if (!obj[key].isBool()) {
+        std::cerr << "Config: " << where << "." << key << " must be true or false" << std::endl;
+        return false;
+    }
+    out = obj[key].asBool();
+    return true;
+}
+
+// 阈值必须在 [0, 1] 内
+bool readThreshold(const Json::Value& obj, const char* key, const std::string& where, float& out) {
+    if (!obj.isMember(key)) {
+        return true;
+    }
+    const Json::Value& value = obj[key];
+    if (!value.isNumeric() || value.asDouble() < 0 || value.asDouble() > 1) {
+        std::cerr << "Config: " << where << "." << key << " must be a number in [0, 1]" << std::endl;
+        return false;
+    }
+    out = value.asFloat();
+    return true;
+}
+
+// [x, y] 形式的点
+bool readPoint(const Json::Value& value, const std::string& where, cv::Point2f& out) {
+    if (!value.isArray() || value.size() != 2 || !value[0].isNumeric() || !value[1].isNumeric()) {
+        std::cerr << "Config: " << where << " must be [x, y]" << std::endl;
+        return false;
+    }
+    out = cv::Point2f(value[0].asFloat(), value[1].asFloat());
+    return true;
+}
+
+// [width, height] 形式的尺寸
+bool readSize(const Json::Value& obj, const char* key, const std::string& where, cv::Size& out) {
+    if (!obj.isMember(key)) {
+        return true;
+    }
+    const Json::Value& value = obj[key];
+    if (!value.isArray() || value.size() != 2 || !value[0].isIntegral() || !value[1].isIntegral() ||
+        value[0].asInt() < 0 || value[1].asInt() < 0) {
+        std::cerr << "Config: " << where << "." << key << " must be [width, height]" << std::endl;
+        return false;
+    }
+    out = cv::Size(value[0].asInt(), value[1].asInt());
+    return true;
+}
+
+bool readModel(const Json::Value& models, ModelConfig& model) {
+    if (!models.isMember(model.name)) {
+        return true;
+    }
+    const Json::Value& obj = models[model.name];
+    const std::string where = "models." + model.name;
+    if (!obj.isObject()) {
+        std::cerr << "Config: " << where << " must be an object" << std::endl;
+        return false;
+    }
+    warnUnknownKeys(obj, where, {"path", "instances", "inputSize", "boxThreshold", "nmsThreshold", "pipelined"});
+    if (obj.isMember("path")) {
+        if (!obj["path"].isString() || obj["path"].asString().empty()) {
+            std::cerr << "Config: " << where << ".path must be a non-empty string" << std::endl;
+            return false;
+        }
+        model.path = obj["path"].asString();
+    }
+    return readInt(obj, "instances", where, 1, model.instances) &&
+           readSize(obj, "inputSize", where, model.inputSize) &&
+           readThreshold(obj, "boxThreshold", where, model.boxThreshold) &&
+           readThreshold(obj, "nmsThreshold", where, model.nmsThreshold) &&
+           readBool(obj, "pipelined", where, model.pipelined);
+}
+
+bool readStream(const Json::Value& obj, const std::string& where, StreamConfig& stream) {
+    if (!obj.isObject()) {
+        std::cerr << "Config: " << where << " must be an object" << std::endl;
+        return false;
+    }
+    warnUnknownKeys(obj, where, {"source", "frameSize", "sampleIntervalMs", "loiterMs", "zones", "lines"});
+    if (obj.isMember("source")) {
+        if (!obj["source"].isString()) {
+            std::cerr << "Config: " << where << ".source must be a string" << std::endl;
+            return false;
+        }
+        stream.source = obj["source"].asString();
+    }
+    if (!readSize(obj, "frameSize", where, stream.frameSize) ||
+        !readInt(obj, "sampleIntervalMs", where, 0, stream.sampleIntervalMs) ||
+        !readInt(obj, "loiterMs", where, static_cast<int64_t>(0), stream.loiterMs)) {
+        return false;
+    }
+
+    if (obj.isMember("zones")) {
+        const Json::Value& zones = obj["zones"];
+        if (!zones.isArray()) {
+            std::cerr << "Config: " << where << ".zones must be an array" << std::endl;
+            return false;
+        }
+        stream.zones.clear();
+        for (Json::ArrayIndex i = 0; i < zones.size(); ++i) {
+            const std::string zoneWhere = where + ".zones[" + std::to_string(i) + "]";
+            if (!zones[i].isObject() || !zones[i]["name"].isString() || !zones[i]["polygon"].isArray() ||
+                zones[i]["polygon"].size() < 3) {
+                std::cerr << "Config: " << zoneWhere << " must have a name and a polygon of at least 3 points" << std::endl;
+                return false;
+            }
+            const Json::Value& polygon = zones[i]["polygon"];
+            Zone zone;
+            zone.name = zones[i]["name"].asString();
+            for (Json::ArrayIndex k = 0; k < polygon.size(); ++k) {
+                cv::Point2f point;
+                if (!readPoint(polygon[k], zoneWhere + ".polygon[" + std::to_string(k) + "]", point)) {
+                    return false;
+                }
+                zone.polygon.emplace_back(static_cast<int>(std::lround(point.x)), static_cast<int>(std::lround(point.y)));
+            }
+            stream.zones.push_back(std::move(zone));
+        }
+    }
+
+    if (obj.isMember("lines")) {
+        const Json::Value& lines = obj["lines"];
+        if (!lines.isArray()) {
+            std::cerr << "Config: " << where << ".lines must be an array" << std::endl;
+            return false;
+        }
+        stream.lines.clear();
+        for (Json::ArrayIndex i = 0; i < lines.size(); ++i) {
+            const std::string lineWhere = where + ".lines[" + std::to_string(i) + "]";
+            if (!lines[i].isObject() || !lines[i]["name"].isString()) {
+                std::cerr << "Config: " << lineWhere << " must have a name, p1 and p2" << std::endl;
+                return false;
+            }
+            CountLine line;
+            line.name = lines[i]["name"].asString();
+            if (!readPoint(lines[i]["p1"], lineWhere + ".p1", line.p1) ||
+                !readPoint(lines[i]["p2"], lineWhere + ".p2", line.p2)) {
+                return false;
+            }
+            stream.lines.push_back(std::move(line));
+        }
+    }
+    return true;
+}
+
+void appendModel(std::ostringstream& out, const AppConfig& config, const ModelConfig& model) {
+    out << "  model " << model.name << ": " << config.modelFile(model) << ", instances " << model.instances
+        << ", input ";
+    if (model.inputSize.area() > 0) {
+        out << model.inputSize.width << "x" << model.inputSize.height;
+    } else {
+        out << "from model";
+    }
+    out << ", box " << model.boxThreshold << ", nms " << model.nmsThreshold;
+    if (model.pipelined) {
+        out << ", pipelined";
+    }
+    out << "\n";
+}
+
+} // namespace
+
+AppConfig::AppConfig() {
+    perDet.name = "perdet";
+    perDet.path = "perdet.rknn";
+    perDet.boxThreshold = 0.25f;
+    perDet.nmsThreshold = 0.45f;
+
+    // 属性模型只在人员检测结果上运行, 阈值不参与后处理
+    perAttr.name = "perattr";
+    perAttr.path = "perattr.rknn";
+
+    fallDet.name = "falldet";
+    fallDet.path = "falldet.rknn";
+    fallDet.boxThreshold = 0.5f;
+    fallDet.nmsThreshold = 0.01f;
+
+    fireSmokeDet.name = "firesmoke";
+    fireSmokeDet.path = "firesmoke.rknn";
+    fireSmokeDet.boxThreshold = 0.5f;
+    fireSmokeDet.nmsThreshold = 0.01f;
+
+    StreamConfig stream;
+    stream.zones.push_back({"region0", {cv::Point(350, 50), cv::Point(500, 80), cv::Point(550, 250), cv::Point(400, 300)}});
+    stream.lines.push_back({"line0", cv::Point2f(0, 300), cv::Point2f(1920, 300)});
+    streams.push_back(std::move(stream));
+}
+
+int AppConfig::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open config file: " << path << std::endl;
+        return -1;
+    }
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errors;
+    if (!Json::parseFromStream(builder, file, &root, &errors)) {
+        std::cerr << "Failed to parse config file " << path << ": " << errors << std::endl;
+        return -1;
+    }
+    if (!root.isObject()) {
+        std::cerr << "Config: " << path << " must contain a JSON object" << std::endl;
+        return -1;
+    }
+    warnUnknownKeys(root, "config", {"modelDir", "queueLength", "models", "tracker", "streams"});
+
+    // 在副本上解析, 失败时不留下一半生效的配置
+    AppConfig next(*this);
+    next.sourcePath = path;
+    if (root.isMember("modelDir")) {
+        if (!root["modelDir"].isString()) {
+            std::cerr << "Config: modelDir must be a string" << std::endl;
+            return -1;
+        }
+        next.modelDir = root["modelDir"].asString();
+    }
+    int64_t queueLength = static_cast<int64_t>(next.queueLength);
+    if (!readInt(root, "queueLength", "config", 1, queueLength)) {
+        return -1;
+    }
+    next.queueLength = static_cast<size_t>(queueLength);
+
+    if (root.isMember("models")) {
+        const Json::Value& models = root["models"];
+        if (!models.isObject()) {
+            std::cerr << "Config: models must be an object" << std::endl;
+            return -1;
+        }
+        warnUnknownKeys(models, "models", {"perdet", "perattr", "falldet", "firesmoke"});
+        if (!readModel(models, next.perDet) || !readModel(models, next.perAttr) ||
+            !readModel(models, next.fallDet) || !readModel(models, next.fireSmokeDet)) {
+            return -1;
+        }
+    }
+
+    if (root.isMember("tracker")) {
+        const Json::Value& tracker = root["tracker"];
+        if (!tracker.isObject()) {
+            std::cerr << "Config: tracker must be an object" << std::endl;
+            return -1;
+        }
+        warnUnknownKeys(tracker, "tracker", {"maxAge", "minHits", "iouThreshold", "lowThreshold", "lowIou"});
+        if (!readInt(tracker, "maxAge", "tracker", 1, next.tracker.maxAge) ||
+            !readInt(tracker, "minHits", "tracker", 0, next.tracker.minHits) ||
+            !readThreshold(tracker, "iouThreshold", "tracker", next.tracker.iouThreshold) ||
+            !readThreshold(tracker, "lowThreshold", "tracker", next.tracker.lowThreshold) ||
+            !readThreshold(tracker, "lowIou", "tracker", next.tracker.lowIou)) {
+            return -1;
+        }
+    }
+
+    if (root.isMember("streams")) {
+        const Json::Value& streams = root["streams"];
+        if (!streams.isArray() || streams.empty()) {
+            std::cerr << "Config: streams must be a non-empty array" << std::endl;
+            return -1;
+        }
+        // 配置文件中的流不继承默认区域, 未配置 zones/lines 即不做区域和越线计数
+        next.streams.clear();
+        for (Json::ArrayIndex i = 0; i < streams.size(); ++i) {
+            StreamConfig stream;
+            if (!readStream(streams[i], "streams[" + std::to_string(i) + "]", stream)) {
+                return -1;
+            }
+            next.streams.push_back(std::move(stream));
+        }
+    }
+
+    *this = std::move(next);
+    return 0;
+}
+
+const StreamConfig& AppConfig::streamFor(const std::string& source) const {
+    for (const auto& stream : streams) {
+        if (stream.source == source) {
+            return stream;
+        }
+    }
+    return streams.front();
+}
+
+std::string AppConfig::modelFile(const ModelConfig& model) const {
+    if (model.path.empty() || model.path[0] == '/' || modelDir.empty()) {
+        return model.path;
+    }
+    return modelDir.back() == '/' ? modelDir + model.path : modelDir + "/" + model.path;
+}
+
+std::string AppConfig::summary() const {
+    std::ostringstream out;
+    out << "Config: " << (sourcePath.empty() ? std::string("built-in defaults") : sourcePath) << "\n";
+    out << "  queue length " << queueLength << "\n";
+    for (const ModelConfig* model : {&perDet, &perAttr, &fallDet, &fireSmokeDet}) {
+        appendModel(out, *this, *model);
+    }
+    out << "  tracker: max age " << tracker.maxAge << ", min hits " << tracker.minHits << ", iou "
+        << tracker.iouThreshold << ", low score " << tracker.lowThreshold << ", low iou " << tracker.lowIou << "\n";
+    for (const auto& stream : streams) {
+        out << "  stream " << (stream.source.empty() ? std::string("*") : stream.source) << ": frame "
+            << stream.frameSize.width << "x" << stream.frameSize.height << ", sample every " << stream.sampleIntervalMs
+            << " ms, loiter " << stream.loiterMs << " ms\n";
+        for (const auto& zone : stream.zones) {
+            out << "    zone " << zone.name << ":";
+            for (const auto& point : zone.polygon) {
+                out << " (" << point.x << "," << point.y << ")";
+            }
+            out << "\n";
+        }
+        for (const auto& line : stream.lines) {
+            out << "    line " << line.name << ": (" << line.p1.x << "," << line.p1.y << ") -> (" << line.p2.x << ","
+                << line.p2.y << ")\n";
+        }
+    }
+    std::string text = out.str();
+    text.pop_back();
+    return text;
+}
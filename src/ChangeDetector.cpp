@@ -0,0 +1,91 @@
+#include "ChangeDetector.h"
+
+ChangeDetector::ChangeDetector(int64_t keyframeIntervalMs, int lostFrames, int clearFrames, size_t maxTracks)
+    : keyframeIntervalMs_(keyframeIntervalMs), lostFrames_(lostFrames), clearFrames_(clearFrames), tracks_(maxTracks) {}
+
+void ChangeDetector::beginFrame() {
+    changes_ = 0;
+    tracksUpdated_ = false;
+}
+
+void ChangeDetector::updateTracks(const std::vector<int>& trackIds) {
+    tracksUpdated_ = true;
+    trackFrame_++;
+    for (int id : trackIds) {
+        bool inserted = false;
+        TrackState* state = tracks_.insert(static_cast<uint32_t>(id), &inserted);
+        if (!state) {
+            // 表满时无法跟踪该目标, 按新目标处理以免漏掉
+            changes_ |= NewTrack;
+            continue;
+        }
+        if (inserted) {
+            changes_ |= NewTrack;
+        }
+        state->lastSeenFrame = trackFrame_;
+    }
+}
+
+void ChangeDetector::updateZones(const std::vector<int>& zoneCounts) {
+    if (zoneCounts != zoneCounts_) {
+        changes_ |= ZoneCount;
+        zoneCounts_ = zoneCounts;
+    }
+}
+
+void ChangeDetector::updateHazard(Hazard hazard, bool present) {
+    static const uint32_t onset[HazardCount] = {FallOnset, FireOnset, SmokeOnset};
+    static const uint32_t clear[HazardCount] = {FallClear, FireClear, SmokeClear};
+
+    HazardState& state = hazards_[hazard];
+    if (present) {
+        state.absentFrames = 0;
+        if (!state.active) {
+            state.active = true;
+            changes_ |= onset[hazard];
+        }
+    } else if (state.active && ++state.absentFrames >= clearFrames_) {
+        state.active = false;
+        changes_ |= clear[hazard];
+    }
+}
+
+uint32_t ChangeDetector::endFrame(int64_t nowMs) {
+    // 只在有人检测结果的帧上统计缺失, 其他模型的帧不影响目标丢失判定
+    if (tracksUpdated_) {
+        const uint64_t frame = trackFrame_;
+        const uint64_t lostFrames = static_cast<uint64_t>(lostFrames_);
+        bool lost = false;
+        tracks_.eraseIf([frame, lostFrames, &lost](uint64_t, const TrackState& state) {
+            if (frame - state.lastSeenFrame >= lostFrames) {
+                lost = true;
+                return true;
+            }
+            return false;
+        });
+        if (lost) {
+            changes_ |= TrackLost;
+        }
+    }
+
+    if (changes_ == 0 && keyframeIntervalMs_ > 0 &&
+        (lastPersistMs_ < 0 || nowMs - lastPersistMs_ >= keyframeIntervalMs_)) {
+        changes_ |= Keyframe;
+    }
+    if (changes_ != 0) {
+        lastPersistMs_ = nowMs;
+    }
+    return changes_;
+}
+
+void ChangeDetector::names(uint32_t changes, std::vector<const char*>& out) {
+    static const char* const kNames[] = {
+        "newTrack", "trackLost", "zoneCount", "fallOnset", "fallClear",
+        "fireOnset", "fireClear", "smokeOnset", "smokeClear", "keyframe"
+    };
+    for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+        if (changes & (1u << i)) {
+            out.push_back(kNames[i]);
+        }
+    }
+}
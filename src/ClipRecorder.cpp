@@ -0,0 +1,333 @@
+#include "ClipRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <opencv2/imgcodecs.hpp>
+#include "Metrics.h"
+
+namespace {
+
+// 最小的 MJPEG AVI 封装: 所有帧已在内存中, 各块大小可以预先算出, 一次顺序写完
+class AviBuffer {
+public:
+    void fourcc(const char* cc) { data_.append(cc, 4); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            data_.push_back(static_cast<char>((v >> (i * 8)) & 0xff));
+        }
+    }
+    void u16(uint16_t v) {
+        data_.push_back(static_cast<char>(v & 0xff));
+        data_.push_back(static_cast<char>(v >> 8));
+    }
+    std::string& data() { return data_; }
+
+private:
+    std::string data_;
+};
+
+bool writeMjpegAvi(const std::string& path, const std::vector<std::shared_ptr<const std::vector<uchar>>>& frames,
+                   int width, int height, double fps) {
+    const uint32_t count = static_cast<uint32_t>(frames.size());
+    const uint32_t rate = static_cast<uint32_t>(fps * 1000 + 0.5);   // dwScale = 1000
+    uint32_t moviSize = 4;
+    uint32_t maxFrame = 0;
+    for (const auto& frame : frames) {
+        uint32_t size = static_cast<uint32_t>(frame->size());
+        moviSize += 8 + size + (size & 1);
+        maxFrame = std::max(maxFrame, size);
+    }
+    const uint32_t strlSize = 4 + (8 + 56) + (8 + 40);
+    const uint32_t hdrlSize = 4 + (8 + 56) + (8 + strlSize);
+    const uint32_t idxSize = 16 * count;
+    const uint32_t riffSize = 4 + (8 + hdrlSize) + (8 + moviSize) + (8 + idxSize);
+
+    AviBuffer header;
+    header.fourcc("RIFF"); header.u32(riffSize); header.fourcc("AVI ");
+    header.fourcc("LIST"); header.u32(hdrlSize); header.fourcc("hdrl");
+
+    header.fourcc("avih"); header.u32(56);
+    header.u32(rate ? static_cast<uint32_t>(1000000000ULL / rate) : 0);   // dwMicroSecPerFrame
+    header.u32(static_cast<uint32_t>(maxFrame * fps));                    // dwMaxBytesPerSec
+    header.u32(0);                                                         // dwPaddingGranularity
+    header.u32(0x10);                                                      // AVIF_HASINDEX
+    header.u32(count);
+    header.u32(0);
+    header.u32(1);                                                         // dwStreams
+    header.u32(maxFrame);
+    header.u32(width);
+    header.u32(height);
+    for (int i = 0; i < 4; ++i) header.u32(0);
+
+    header.fourcc("LIST"); header.u32(strlSize); header.fourcc("strl");
+    header.fourcc("strh"); header.u32(56);
+    header.fourcc("vids"); header.fourcc("MJPG");
+    header.u32(0);                                                         // dwFlags
+    header.u16(0); header.u16(0);                                          // wPriority, wLanguage
+    header.u32(0);                                                         // dwInitialFrames
+    header.u32(1000); header.u32(rate);                                    // dwScale, dwRate
+    header.u32(0); header.u32(count);                                      // dwStart, dwLength
+    header.u32(maxFrame);
+    header.u32(0xffffffff);                                                // dwQuality
+    header.u32(0);                                                         // dwSampleSize
+    header.u16(0); header.u16(0); header.u16(width); header.u16(height);   // rcFrame
+
+    header.fourcc("strf"); header.u32(40);
+    header.u32(40); header.u32(width); header.u32(height);
+    header.u16(1); header.u16(24);
+    header.fourcc("MJPG");
+    header.u32(width * height * 3);
+    for (int i = 0; i < 4; ++i) header.u32(0);
+
+    header.fourcc("LIST"); header.u32(moviSize); header.fourcc("movi");
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.write(header.data().data(), header.data().size());
+
+    AviBuffer index;
+    index.fourcc("idx1"); index.u32(idxSize);
+    uint32_t offset = 4;                                                   // 相对 movi 标识
+    const char pad = 0;
+    for (const auto& frame : frames) {
+        uint32_t size = static_cast<uint32_t>(frame->size());
+        AviBuffer chunk;
+        chunk.fourcc("00dc"); chunk.u32(size);
+        file.write(chunk.data().data(), chunk.data().size());
+        file.write(reinterpret_cast<const char*>(frame->data()), size);
+        if (size & 1) {
+            file.write(&pad, 1);
+        }
+        index.fourcc("00dc"); index.u32(0x10); index.u32(offset); index.u32(size);   // AVIIF_KEYFRAME
+        offset += 8 + size + (size & 1);
+    }
+    file.write(index.data().data(), index.data().size());
+    return static_cast<bool>(file);
+}
+
+std::string clipTimeStr(int64_t timestampMs) {
+    std::time_t t = static_cast<std::time_t>(timestampMs / 1000);
+    std::tm* now = std::localtime(&t);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d%H%M%S", now);
+    return buffer;
+}
+
+} // namespace
+
+ClipRecorder::ClipRecorder(const std::string& dir, int64_t preMs, int64_t postMs, double maxFps, size_t maxRingBytes,
+                           int jpegQuality, int64_t lagMs)
+    : dir_(dir), preMs_(preMs), postMs_(postMs),
+      minIntervalMs_(maxFps > 0 ? static_cast<int64_t>(1000.0 / maxFps) : 0), maxRingBytes_(maxRingBytes),
+      params_({cv::IMWRITE_JPEG_QUALITY, std::clamp(jpegQuality, 0, 100)}), lagMs_(std::max<int64_t>(0, lagMs)) {}
+
+ClipRecorder::~ClipRecorder() {
+    stop();
+}
+
+void ClipRecorder::start() {
+    if (running_) {
+        return;
+    }
+    std::filesystem::create_directories(dir_);
+    quit_ = false;
+    writeQuit_ = false;
+    running_ = true;
+    encodeThread_ = std::thread(&ClipRecorder::encodeLoop, this);
+    writeThread_ = std::thread(&ClipRecorder::writeLoop, this);
+}
+
+void ClipRecorder::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    encodeThread_.join();
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        writeQuit_ = true;
+    }
+    writeCv_.notify_all();
+    writeThread_.join();
+    running_ = false;
+}
+
+void ClipRecorder::pushFrame(const cv::Mat& frame, int64_t timestampMs) {
+    if (!running_ || timestampMs - lastAcceptedMs_ < minIntervalMs_) {
+        return;
+    }
+    lastAcceptedMs_ = timestampMs;
+
+    // 采集线程会复用图像缓冲区, 这里必须复制
+    cv::Mat copy = frame.clone();
+    bool replaced;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        replaced = !pendingFrame_.empty();
+        pendingFrame_ = copy;
+        pendingMs_ = timestampMs;
+    }
+    if (replaced) {
+        Metrics::instance().add("clip.dropped");
+    }
+    cv_.notify_one();
+}
+
+void ClipRecorder::trigger(const std::string& reason, int64_t eventMs) {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        events_.push_back({reason, eventMs});
+    }
+    cv_.notify_one();
+}
+
+void ClipRecorder::encodeLoop() {
+    while (true) {
+        cv::Mat frame;
+        int64_t frameMs = 0;
+        std::vector<Event> events;
+        bool quit;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return quit_ || !pendingFrame_.empty() || !events_.empty(); });
+            frame = std::move(pendingFrame_);
+            pendingFrame_ = cv::Mat();
+            frameMs = pendingMs_;
+            events.swap(events_);
+            quit = quit_;
+        }
+
+        // 处理事件: 与正在录制的片段重叠则延长, 否则从环形缓冲中取事件前的帧开始新片段
+        for (const auto& event : events) {
+            // 事件晚于采集到达, 延迟超过预留时放宽环形缓冲的保留时长, 后续片段的事件前部分完整
+            if (!ring_.empty() && ring_.back().timestampMs - event.eventMs > lagMs_) {
+                lagMs_ = ring_.back().timestampMs - event.eventMs;
+                Metrics::instance().set("clip.lag_ms", static_cast<double>(lagMs_));
+            }
+            if (active_ && event.eventMs <= active_->endMs) {
+                active_->endMs = std::max(active_->endMs, event.eventMs + postMs_);
+                if (active_->reason.find(event.reason) == std::string::npos) {
+                    active_->reason += "-" + event.reason;
+                }
+                continue;
+            }
+            finishClip();
+            active_.reset(new Clip{event.reason, event.eventMs, event.eventMs + postMs_, width_, height_, {}});
+            for (const auto& encoded : ring_) {
+                // 延迟超过 postMs 时环形缓冲中已有窗口之后的帧, 不计入片段
+                if (encoded.timestampMs > active_->endMs) {
+                    break;
+                }
+                if (encoded.timestampMs >= event.eventMs - preMs_) {
+                    active_->frames.push_back(encoded);
+                }
+            }
+        }
+
+        if (!frame.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            auto jpeg = std::make_shared<std::vector<uchar>>();
+            if (cv::imencode(".jpg", frame, *jpeg, params_)) {
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                Metrics::instance().observe("clip.encode_ms", elapsed.count());
+                width_ = frame.cols;
+                height_ = frame.rows;
+
+                EncodedFrame encoded{frameMs, jpeg};
+                ring_.push_back(encoded);
+                ringBytes_ += jpeg->size();
+                // 保留事件前需要的时长加上事件的延迟, 同时限制总字节数
+                while (!ring_.empty() &&
+                       (ring_.front().timestampMs < frameMs - preMs_ - lagMs_ || ringBytes_ > maxRingBytes_)) {
+                    ringBytes_ -= ring_.front().jpeg->size();
+                    ring_.pop_front();
+                }
+                Metrics::instance().set("clip.ring_bytes", static_cast<double>(ringBytes_));
+
+                if (active_) {
+                    if (active_->width == 0) {
+                        active_->width = width_;
+                        active_->height = height_;
+                    }
+                    if (frameMs <= active_->endMs) {
+                        active_->frames.push_back(encoded);
+                    } else {
+                        finishClip();
+                    }
+                }
+            }
+        }
+
+        if (quit) {
+            finishClip();
+            return;
+        }
+    }
+}
+
+void ClipRecorder::finishClip() {
+    if (!active_) {
+        return;
+    }
+    if (active_->frames.empty()) {
+        active_.reset();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        finished_.push_back(std::move(active_));
+    }
+    writeCv_.notify_one();
+}
+
+void ClipRecorder::writeLoop() {
+    while (true) {
+        std::unique_ptr<Clip> clip;
+        {
+            std::unique_lock<std::mutex> lock(writeMtx_);
+            writeCv_.wait(lock, [this] { return writeQuit_ || !finished_.empty(); });
+            if (finished_.empty()) {
+                return;
+            }
+            clip = std::move(finished_.front());
+            finished_.pop_front();
+        }
+        writeClip(*clip);
+    }
+}
+
+void ClipRecorder::writeClip(const Clip& clip) {
+    std::vector<std::shared_ptr<const std::vector<uchar>>> frames;
+    frames.reserve(clip.frames.size());
+    for (const auto& encoded : clip.frames) {
+        frames.push_back(encoded.jpeg);
+    }
+    // 按实际时间跨度计算帧率, 保证回放时长与事件时长一致
+    double fps = 1000.0 / std::max<int64_t>(minIntervalMs_, 1);
+    int64_t spanMs = clip.frames.back().timestampMs - clip.frames.front().timestampMs;
+    if (clip.frames.size() > 1 && spanMs > 0) {
+        fps = (clip.frames.size() - 1) * 1000.0 / spanMs;
+    }
+
+    std::string dir = dirFor_ ? dirFor_(clip.eventMs) : dir_;
+    std::string path = dir + "/" + clip.reason + "_" + clipTimeStr(clip.eventMs) + ".avi";
+    if (writeMjpegAvi(path, frames, clip.width, clip.height, fps)) {
+        Metrics::instance().add("clip.written");
+        std::cout << "Saved event clip " << path << " (" << frames.size() << " frames)" << std::endl;
+    } else {
+        std::cerr << "Failed to write event clip: " << path << std::endl;
+    }
+}
@@ -0,0 +1,546 @@
+#include "DatabaseManager.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include "Metrics.h"
+
+namespace {
+
+const int64_t kMinuteMs = 60 * 1000;
+const int64_t kHourMs = 60 * kMinuteMs;
+
+// 每个事务最多删除的行数, 保证写锁持有时间在毫秒级
+const int kPruneChunkRows = 2000;
+
+// 过期数据删除语句: ?1 截止时间, ?2 每块行数
+// 子表先于 frames 删除; rtsp_logs 的时间为本地时间字符串, 与截止时间按字典序比较
+enum PruneCutoff { PruneRaw, PruneRawText, PruneRollup };
+struct PruneSql {
+    const char* sql;
+    PruneCutoff cutoff;
+};
+const PruneSql kPruneSql[] = {
+    {"DELETE FROM detections WHERE frame_row IN (SELECT id FROM frames WHERE ts_ms < ?1 ORDER BY ts_ms LIMIT ?2);", PruneRaw},
+    {"DELETE FROM zone_counts WHERE frame_row IN (SELECT id FROM frames WHERE ts_ms < ?1 ORDER BY ts_ms LIMIT ?2);", PruneRaw},
+    {"DELETE FROM frames WHERE id IN (SELECT id FROM frames WHERE ts_ms < ?1 ORDER BY ts_ms LIMIT ?2);", PruneRaw},
+    {"DELETE FROM rtsp_logs WHERE rowid IN (SELECT rowid FROM rtsp_logs WHERE timestamp < ?1 ORDER BY timestamp LIMIT ?2);", PruneRawText},
+    {"DELETE FROM loiter_events WHERE rowid IN (SELECT rowid FROM loiter_events WHERE event_ms < ?1 LIMIT ?2);", PruneRaw},
+    {"DELETE FROM tracks WHERE rowid IN (SELECT rowid FROM tracks WHERE last_ms < ?1 LIMIT ?2);", PruneRaw},
+    {"DELETE FROM rollup_minute WHERE (ip_address, metric, bucket_ms) IN "
+     "(SELECT ip_address, metric, bucket_ms FROM rollup_minute WHERE bucket_ms < ?1 LIMIT ?2);", PruneRollup},
+};
+
+// 与采集线程写入 rtsp_logs 的格式一致
+std::string localTimeString(int64_t ms) {
+    std::time_t t = static_cast<std::time_t>(ms / 1000);
+    std::tm local{};
+    localtime_r(&t, &local);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    return buffer;
+}
+
+} // namespace
+
+DatabaseManager::DatabaseManager(const std::string& dbName, size_t batchSize, int flushIntervalMs, size_t maxPending)
+    : batchSize_(batchSize > 0 ? batchSize : 1), flushIntervalMs_(flushIntervalMs), maxPending_(maxPending),
+      sessionMs_(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch()).count()) {
+    // 打开或创建数据库
+    if (sqlite3_open(dbName.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
+        disable(dbName);
+        return;
+    }
+
+    // WAL 模式下读写互不阻塞, 每次提交只需顺序追加日志
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+        std::cerr << "SQL Error: " << errorMessage << std::endl;
+        sqlite3_free(errorMessage);
+    }
+    createTable();
+    // 语句预编译失败 (常见于表结构不同的旧 data.db) 时不启动写线程, 否则每条记录都会在空语句上失败
+    if (!prepareStatements()) {
+        disable(dbName);
+        return;
+    }
+
+    writer_ = std::thread(&DatabaseManager::writerLoop, this);
+}
+
+void DatabaseManager::disable(const std::string& dbName) {
+    disabled_ = true;
+    std::cerr << "Database " << dbName << " disabled, results are not stored in it "
+              << "(move away an old database file with a different schema to recreate it)" << std::endl;
+    Metrics::instance().set("db.disabled", 1);
+}
+
+DatabaseManager::~DatabaseManager() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    sqlite3_finalize(insertLogStmt_);
+    sqlite3_finalize(insertLoiterStmt_);
+    sqlite3_finalize(insertFrameStmt_);
+    sqlite3_finalize(insertDetectionStmt_);
+    sqlite3_finalize(insertZoneCountStmt_);
+    sqlite3_finalize(upsertTrackStmt_);
+    sqlite3_finalize(upsertRollupStmt_[0]);
+    sqlite3_finalize(upsertRollupStmt_[1]);
+    for (sqlite3_stmt* stmt : pruneStmts_) {
+        sqlite3_finalize(stmt);
+    }
+    // 关闭数据库
+    sqlite3_close(db);
+}
+
+// 创建表
+void DatabaseManager::createTable() {
+    const char* createTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS rtsp_logs (
+            timestamp TEXT,
+            ip_address TEXT,
+            rtsp_url TEXT,
+            data TEXT,
+            PRIMARY KEY (ip_address, timestamp)
+        );
+        CREATE INDEX IF NOT EXISTS idx_rtsp_logs_ts ON rtsp_logs (timestamp);
+        CREATE TABLE IF NOT EXISTS loiter_events (
+            ip_address TEXT,
+            track_id INTEGER,
+            zone TEXT,
+            kind TEXT,
+            enter_ms INTEGER,
+            event_ms INTEGER,
+            dwell_ms INTEGER
+        );
+
+        -- 结构化结果, 时间统一为毫秒整数
+        CREATE TABLE IF NOT EXISTS frames (
+            id INTEGER PRIMARY KEY,
+            ip_address TEXT NOT NULL,
+            rtsp_url TEXT,
+            ts_ms INTEGER NOT NULL,
+            frame_id INTEGER,
+            session_ms INTEGER,
+            person_count INTEGER,
+            fall_count INTEGER,
+            fire_count INTEGER,
+            smoke_count INTEGER
+        );
+        CREATE INDEX IF NOT EXISTS idx_frames_ip_ts ON frames (ip_address, ts_ms);
+        CREATE INDEX IF NOT EXISTS idx_frames_ts ON frames (ts_ms);
+
+        -- model: 0 人 / 1 跌倒 / 2 火焰烟雾, 与二进制检测日志一致
+        CREATE TABLE IF NOT EXISTS detections (
+            frame_row INTEGER NOT NULL REFERENCES frames (id),
+            model INTEGER NOT NULL,
+            class_id INTEGER,
+            track_id INTEGER,
+            confidence REAL,
+            x REAL,
+            y REAL,
+            width REAL,
+            height REAL
+        );
+        CREATE INDEX IF NOT EXISTS idx_detections_frame ON detections (frame_row);
+        CREATE INDEX IF NOT EXISTS idx_detections_track ON detections (track_id, frame_row);
+
+        CREATE TABLE IF NOT EXISTS zone_counts (
+            frame_row INTEGER NOT NULL REFERENCES frames (id),
+            zone TEXT NOT NULL,
+            count INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_zone_counts_zone ON zone_counts (zone, frame_row);
+
+        CREATE TABLE IF NOT EXISTS tracks (
+            ip_address TEXT NOT NULL,
+            session_ms INTEGER NOT NULL,
+            track_id INTEGER NOT NULL,
+            first_ms INTEGER NOT NULL,
+            last_ms INTEGER NOT NULL,
+            frames INTEGER NOT NULL,
+            PRIMARY KEY (ip_address, session_ms, track_id)
+        );
+        CREATE INDEX IF NOT EXISTS idx_tracks_first ON tracks (ip_address, first_ms);
+
+        -- 按分钟/小时汇总: 每个桶每个指标一行, avg = total / samples
+        CREATE TABLE IF NOT EXISTS rollup_minute (
+            ip_address TEXT NOT NULL,
+            metric TEXT NOT NULL,
+            bucket_ms INTEGER NOT NULL,
+            samples INTEGER NOT NULL,
+            total INTEGER NOT NULL,
+            max_value INTEGER NOT NULL,
+            PRIMARY KEY (ip_address, metric, bucket_ms)
+        ) WITHOUT ROWID;
+        CREATE TABLE IF NOT EXISTS rollup_hour (
+            ip_address TEXT NOT NULL,
+            metric TEXT NOT NULL,
+            bucket_ms INTEGER NOT NULL,
+            samples INTEGER NOT NULL,
+            total INTEGER NOT NULL,
+            max_value INTEGER NOT NULL,
+            PRIMARY KEY (ip_address, metric, bucket_ms)
+        ) WITHOUT ROWID;
+    )";
+
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(db, createTableSQL, nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+        std::cerr << "SQL Error: " << errorMessage << std::endl;
+        sqlite3_free(errorMessage);
+    }
+}
+
+bool DatabaseManager::prepareStatements() {
+    // 同一秒内的重复帧保留第一条, 与原先主键冲突时的行为一致
+    const char* insertLogSQL = "INSERT OR IGNORE INTO rtsp_logs (timestamp, ip_address, rtsp_url, data) VALUES (?1, ?2, ?3, ?4);";
+    const char* insertLoiterSQL = "INSERT INTO loiter_events (ip_address, track_id, zone, kind, enter_ms, event_ms, dwell_ms) "
+                                  "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);";
+    const char* insertFrameSQL = "INSERT INTO frames (ip_address, rtsp_url, ts_ms, frame_id, session_ms, person_count, "
+                                 "fall_count, fire_count, smoke_count) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9);";
+    const char* insertDetectionSQL = "INSERT INTO detections (frame_row, model, class_id, track_id, confidence, x, y, width, height) "
+                                     "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9);";
+    const char* insertZoneCountSQL = "INSERT INTO zone_counts (frame_row, zone, count) VALUES (?1, ?2, ?3);";
+    const char* upsertTrackSQL = "INSERT INTO tracks (ip_address, session_ms, track_id, first_ms, last_ms, frames) "
+                                 "VALUES (?1, ?2, ?3, ?4, ?4, 1) "
+                                 "ON CONFLICT (ip_address, session_ms, track_id) DO UPDATE SET "
+                                 "last_ms = max(last_ms, excluded.last_ms), frames = frames + 1;";
+    const char* upsertRollupSQL[2] = {
+        "INSERT INTO rollup_minute (ip_address, metric, bucket_ms, samples, total, max_value) VALUES (?1, ?2, ?3, ?4, ?5, ?6) "
+        "ON CONFLICT (ip_address, metric, bucket_ms) DO UPDATE SET samples = samples + excluded.samples, "
+        "total = total + excluded.total, max_value = max(max_value, excluded.max_value);",
+        "INSERT INTO rollup_hour (ip_address, metric, bucket_ms, samples, total, max_value) VALUES (?1, ?2, ?3, ?4, ?5, ?6) "
+        "ON CONFLICT (ip_address, metric, bucket_ms) DO UPDATE SET samples = samples + excluded.samples, "
+        "total = total + excluded.total, max_value = max(max_value, excluded.max_value);"
+    };
+    if (sqlite3_prepare_v2(db, insertLogSQL, -1, &insertLogStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, insertLoiterSQL, -1, &insertLoiterStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, insertFrameSQL, -1, &insertFrameStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, insertDetectionSQL, -1, &insertDetectionStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, insertZoneCountSQL, -1, &insertZoneCountStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, upsertTrackSQL, -1, &upsertTrackStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, upsertRollupSQL[0], -1, &upsertRollupStmt_[0], nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, upsertRollupSQL[1], -1, &upsertRollupStmt_[1], nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    for (const auto& prune : kPruneSql) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, prune.sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Error preparing statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        pruneStmts_.push_back(stmt);
+    }
+    return true;
+}
+
+void DatabaseManager::insertLog(const std::string& timestamp, const std::string& ip_address, const std::string& rtsp_url,
+                                std::shared_ptr<const std::string> data) {
+    enqueue(LogRow{timestamp, ip_address, rtsp_url, std::move(data)});
+}
+
+void DatabaseManager::insertFrame(const std::string& ip_address, const std::string& rtsp_url, int64_t timestamp_ms,
+                                  uint64_t frame_id, std::vector<DetLogRecord> detections,
+                                  std::vector<std::pair<std::string, int>> zone_counts) {
+    enqueue(FrameRow{ip_address, rtsp_url, timestamp_ms, frame_id, std::move(detections), std::move(zone_counts)});
+}
+
+void DatabaseManager::insertLoiterEvent(const std::string& ip_address, int track_id, const std::string& zone, const std::string& kind,
+                                        int64_t enter_ms, int64_t event_ms, int64_t dwell_ms) {
+    enqueue(LoiterRow{ip_address, track_id, zone, kind, enter_ms, event_ms, dwell_ms});
+}
+
+void DatabaseManager::enqueue(Row&& row) {
+    if (disabled_) {
+        Metrics::instance().add("db.errors");
+        return;
+    }
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (pending_.size() >= maxPending_) {
+            pending_.pop_front(); // 磁盘跟不上时丢弃最旧的记录, 不阻塞调用线程
+            dropped_++;
+            Metrics::instance().add("db.dropped");
+        }
+        pending_.push_back(std::move(row));
+        depth = pending_.size();
+    }
+    Metrics::instance().set("db.queue_depth", static_cast<double>(depth));
+    if (depth >= batchSize_) {
+        cv_.notify_one();
+    }
+}
+
+void DatabaseManager::prune(int64_t beforeMs, int64_t rollupBeforeMs) {
+    if (disabled_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pruneRequested_ = true;
+        pruneBeforeMs_ = beforeMs;
+        pruneRollupBeforeMs_ = rollupBeforeMs;
+    }
+    cv_.notify_one();
+}
+
+void DatabaseManager::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    flushRequested_ = true;
+    cv_.notify_one();
+    drainedCv_.wait(lock, [this] { return (pending_.empty() && inFlight_ == 0) || !writer_.joinable(); });
+}
+
+uint64_t DatabaseManager::dropped() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return dropped_;
+}
+
+void DatabaseManager::writerLoop() {
+    std::deque<Row> batch;
+    bool prune = false;
+    int64_t pruneBeforeMs = 0;
+    int64_t pruneRollupBeforeMs = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            // 攒够一批或超时后提交
+            cv_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_),
+                         [this] { return quit_ || flushRequested_ || pending_.size() >= batchSize_; });
+            flushRequested_ = false;
+            if (pending_.empty()) {
+                drainedCv_.notify_all();
+                if (quit_) {
+                    return;
+                }
+                if (!pruneRequested_) {
+                    continue;
+                }
+            }
+            batch.swap(pending_);
+            inFlight_ = batch.size();
+            prune = pruneRequested_;
+            pruneRequested_ = false;
+            pruneBeforeMs = pruneBeforeMs_;
+            pruneRollupBeforeMs = pruneRollupBeforeMs_;
+        }
+
+        if (!batch.empty()) {
+            writeBatch(batch);
+            batch.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            inFlight_ = 0;
+        }
+        drainedCv_.notify_all();
+
+        // 过期数据在两批写入之间删除, 没删完则下一轮继续
+        if (prune && !pruneExpired(pruneBeforeMs, pruneRollupBeforeMs)) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!pruneRequested_) {
+                pruneRequested_ = true;
+                pruneBeforeMs_ = pruneBeforeMs;
+                pruneRollupBeforeMs_ = pruneRollupBeforeMs;
+            }
+        }
+    }
+}
+
+void DatabaseManager::writeBatch(std::deque<Row>& batch) {
+    auto start = std::chrono::steady_clock::now();
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    for (const auto& row : batch) {
+        writeRow(row);
+    }
+    // 汇总增量在同一事务中合并, 每个桶每个指标每批只写一次
+    writeRollups();
+    char* errorMessage = nullptr;
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+        std::cerr << "SQL Error: " << errorMessage << std::endl;
+        sqlite3_free(errorMessage);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    Metrics::instance().observe("db.commit_ms", elapsed.count());
+    Metrics::instance().add("db.rows", static_cast<int64_t>(batch.size()));
+}
+
+void DatabaseManager::writeRow(const Row& row) {
+    if (const FrameRow* frame = std::get_if<FrameRow>(&row)) {
+        writeFrame(*frame);
+        return;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (const LogRow* log = std::get_if<LogRow>(&row)) {
+        stmt = insertLogStmt_;
+        sqlite3_bind_text(stmt, 1, log->timestamp.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, log->ip_address.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, log->rtsp_url.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, log->data->data(), static_cast<int>(log->data->size()), SQLITE_STATIC);
+    } else if (const LoiterRow* event = std::get_if<LoiterRow>(&row)) {
+        stmt = insertLoiterStmt_;
+        sqlite3_bind_text(stmt, 1, event->ip_address.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, event->track_id);
+        sqlite3_bind_text(stmt, 3, event->zone.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, event->kind.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 5, event->enter_ms);
+        sqlite3_bind_int64(stmt, 6, event->event_ms);
+        sqlite3_bind_int64(stmt, 7, event->dwell_ms);
+    }
+    if (!stmt) {
+        return;
+    }
+    step(stmt);
+}
+
+void DatabaseManager::writeFrame(const FrameRow& frame) {
+    int64_t counts[4] = {0, 0, 0, 0};   // 人, 跌倒, 火焰, 烟雾
+    for (const auto& det : frame.detections) {
+        switch (static_cast<DetLogModel>(det.model)) {
+        case DetLogModel::Person: counts[0]++; break;
+        case DetLogModel::Fall: counts[1]++; break;
+        case DetLogModel::FireSmoke: counts[det.classId == 0 ? 2 : 3]++; break;
+        }
+    }
+
+    sqlite3_bind_text(insertFrameStmt_, 1, frame.ip_address.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertFrameStmt_, 2, frame.rtsp_url.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insertFrameStmt_, 3, frame.timestamp_ms);
+    sqlite3_bind_int64(insertFrameStmt_, 4, static_cast<sqlite3_int64>(frame.frame_id));
+    sqlite3_bind_int64(insertFrameStmt_, 5, sessionMs_);
+    for (int i = 0; i < 4; ++i) {
+        sqlite3_bind_int64(insertFrameStmt_, 6 + i, counts[i]);
+    }
+    if (!step(insertFrameStmt_)) {
+        return;
+    }
+    sqlite3_int64 frameRow = sqlite3_last_insert_rowid(db);
+
+    for (const auto& det : frame.detections) {
+        sqlite3_bind_int64(insertDetectionStmt_, 1, frameRow);
+        sqlite3_bind_int(insertDetectionStmt_, 2, det.model);
+        sqlite3_bind_int(insertDetectionStmt_, 3, det.classId);
+        if (det.trackId >= 0) {
+            sqlite3_bind_int(insertDetectionStmt_, 4, det.trackId);
+        }
+        sqlite3_bind_double(insertDetectionStmt_, 5, det.confidence);
+        sqlite3_bind_double(insertDetectionStmt_, 6, det.x);
+        sqlite3_bind_double(insertDetectionStmt_, 7, det.y);
+        sqlite3_bind_double(insertDetectionStmt_, 8, det.width);
+        sqlite3_bind_double(insertDetectionStmt_, 9, det.height);
+        step(insertDetectionStmt_);
+
+        if (det.trackId >= 0) {
+            sqlite3_bind_text(upsertTrackStmt_, 1, frame.ip_address.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(upsertTrackStmt_, 2, sessionMs_);
+            sqlite3_bind_int(upsertTrackStmt_, 3, det.trackId);
+            sqlite3_bind_int64(upsertTrackStmt_, 4, frame.timestamp_ms);
+            step(upsertTrackStmt_);
+        }
+    }
+
+    for (const auto& zone : frame.zone_counts) {
+        sqlite3_bind_int64(insertZoneCountStmt_, 1, frameRow);
+        sqlite3_bind_text(insertZoneCountStmt_, 2, zone.first.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(insertZoneCountStmt_, 3, zone.second);
+        step(insertZoneCountStmt_);
+        addRollup(frame.ip_address, frame.timestamp_ms, "zone." + zone.first, zone.second);
+    }
+
+    static const char* const metrics[4] = {"person", "fall", "fire", "smoke"};
+    for (int i = 0; i < 4; ++i) {
+        addRollup(frame.ip_address, frame.timestamp_ms, metrics[i], counts[i]);
+    }
+}
+
+void DatabaseManager::addRollup(const std::string& ip_address, int64_t timestamp_ms, const std::string& metric, int64_t value) {
+    const int64_t bucketMs[2] = {kMinuteMs, kHourMs};
+    for (int g = 0; g < 2; ++g) {
+        int64_t bucket = timestamp_ms - timestamp_ms % bucketMs[g];
+        RollupValue& rollup = rollups_[RollupKey(g, ip_address, bucket, metric)];
+        rollup.samples++;
+        rollup.total += value;
+        rollup.maxValue = std::max(rollup.maxValue, value);
+    }
+}
+
+void DatabaseManager::writeRollups() {
+    for (const auto& item : rollups_) {
+        sqlite3_stmt* stmt = upsertRollupStmt_[std::get<0>(item.first)];
+        sqlite3_bind_text(stmt, 1, std::get<1>(item.first).c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, std::get<3>(item.first).c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, std::get<2>(item.first));
+        sqlite3_bind_int64(stmt, 4, item.second.samples);
+        sqlite3_bind_int64(stmt, 5, item.second.total);
+        sqlite3_bind_int64(stmt, 6, item.second.maxValue);
+        step(stmt);
+    }
+    rollups_.clear();
+}
+
+bool DatabaseManager::pruneExpired(int64_t beforeMs, int64_t rollupBeforeMs) {
+    const std::string beforeText = localTimeString(beforeMs);
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        bool more = false;
+        int64_t deleted = 0;
+        sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+        for (size_t i = 0; i < pruneStmts_.size(); ++i) {
+            sqlite3_stmt* stmt = pruneStmts_[i];
+            switch (kPruneSql[i].cutoff) {
+            case PruneRaw: sqlite3_bind_int64(stmt, 1, beforeMs); break;
+            case PruneRawText: sqlite3_bind_text(stmt, 1, beforeText.c_str(), -1, SQLITE_STATIC); break;
+            case PruneRollup: sqlite3_bind_int64(stmt, 1, rollupBeforeMs); break;
+            }
+            sqlite3_bind_int(stmt, 2, kPruneChunkRows);
+            if (step(stmt)) {
+                int changes = sqlite3_changes(db);
+                deleted += changes;
+                // detections / zone_counts 每帧多行, 是否删完以 frames 为准
+                if (i >= 2 && changes >= kPruneChunkRows) {
+                    more = true;
+                }
+            }
+        }
+        char* errorMessage = nullptr;
+        if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, &errorMessage) != SQLITE_OK) {
+            std::cerr << "SQL Error: " << errorMessage << std::endl;
+            sqlite3_free(errorMessage);
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return true;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::instance().observe("db.prune_ms", elapsed.count());
+        Metrics::instance().add("db.pruned_rows", deleted);
+        if (!more) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (quit_ || flushRequested_ || pending_.size() >= batchSize_) {
+            return false;
+        }
+    }
+}
+
+bool DatabaseManager::step(sqlite3_stmt* stmt) {
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) {
+        std::cerr << "Error executing statement: " << sqlite3_errmsg(db) << std::endl;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
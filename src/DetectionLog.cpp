@@ -0,0 +1,296 @@
+#include "DetectionLog.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'A', 'I', 'B', 'X', 'D', 'L', 'G', '1'};
+// 版本 2: 记录和索引按采集序号排序 (版本 1 使用循环的帧ID)
+const uint32_t kVersion = 2;
+
+std::string segmentName(int64_t timestampMs) {
+    char name[32];
+    // 定宽文件名, 按文件名排序即按时间排序
+    std::snprintf(name, sizeof(name), "%013lld.dlog", static_cast<long long>(timestampMs));
+    return name;
+}
+
+std::string indexPath(const std::string& segmentPath) {
+    return segmentPath.substr(0, segmentPath.size() - 5) + ".idx";
+}
+
+bool readHeader(int fd, DetLogSegmentHeader& header) {
+    if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        return false;
+    }
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+           header.recordSize == sizeof(DetLogRecord);
+}
+
+// 扫描一个段, key 取记录中单调不减的字段 (时间戳或采集序号)
+template <typename Key, typename KeyOf, typename IndexKeyOf>
+uint64_t scanSegment(const std::string& path, Key begin, Key end, KeyOf keyOf, IndexKeyOf indexKeyOf,
+                     const std::function<bool(const DetLogRecord&)>& fn, bool& stop) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    // 重新读取文件头, 获取最新的记录数
+    DetLogSegmentHeader header;
+    if (!readHeader(fd, header) || header.recordCount == 0) {
+        ::close(fd);
+        return 0;
+    }
+    uint64_t count = std::min(header.recordCount, header.capacity);
+    size_t mapSize = sizeof(DetLogSegmentHeader) + count * sizeof(DetLogRecord);
+    void* map = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to mmap detection log segment: " << path << std::endl;
+        return 0;
+    }
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+    const DetLogRecord* records = reinterpret_cast<const DetLogRecord*>(
+        static_cast<const char*>(map) + sizeof(DetLogSegmentHeader));
+
+    // 在稀疏索引中找到最后一个小于 begin 的索引项, 从该记录开始顺序扫描
+    uint64_t start = 0;
+    FILE* indexFile = std::fopen(indexPath(path).c_str(), "rb");
+    if (indexFile) {
+        std::vector<DetLogIndexEntry> index;
+        DetLogIndexEntry entry;
+        while (std::fread(&entry, sizeof(entry), 1, indexFile) == 1) {
+            index.push_back(entry);
+        }
+        std::fclose(indexFile);
+        auto it = std::lower_bound(index.begin(), index.end(), begin,
+                                   [&indexKeyOf](const DetLogIndexEntry& e, Key key) { return indexKeyOf(e) < key; });
+        if (it != index.begin()) {
+            start = std::min((it - 1)->recordIdx, count);
+        }
+    }
+
+    uint64_t scanned = 0;
+    for (uint64_t i = start; i < count; ++i) {
+        Key key = keyOf(records[i]);
+        if (key >= end) {
+            break;
+        }
+        if (key < begin) {
+            continue;
+        }
+        scanned++;
+        if (!fn(records[i])) {
+            stop = true;
+            break;
+        }
+    }
+    munmap(map, mapSize);
+    return scanned;
+}
+
+} // namespace
+
+DetectionLogWriter::DetectionLogWriter(const std::string& dir, uint64_t segmentRecords, int64_t segmentSpanMs,
+                                       uint32_t indexStride)
+    : dir_(dir), segmentRecords_(std::max<uint64_t>(1, segmentRecords)), segmentSpanMs_(segmentSpanMs),
+      indexStride_(std::max<uint32_t>(1, indexStride)) {
+    std::filesystem::create_directories(dir_);
+}
+
+DetectionLogWriter::~DetectionLogWriter() {
+    closeSegment();
+}
+
+int DetectionLogWriter::openSegment(const std::string& dir, int64_t timestampMs) {
+    segmentDir_ = dir;
+    std::string path = dir + "/" + segmentName(timestampMs);
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open detection log segment " << path << ": " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    mapSize_ = sizeof(DetLogSegmentHeader) + segmentRecords_ * sizeof(DetLogRecord);
+    // 稀疏文件, 实际占用随写入增长
+    if (ftruncate(fd_, static_cast<off_t>(mapSize_)) != 0) {
+        std::cerr << "Failed to resize detection log segment " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+        return -1;
+    }
+    map_ = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        std::cerr << "Failed to mmap detection log segment " << path << ": " << std::strerror(errno) << std::endl;
+        map_ = nullptr;
+        ::close(fd_);
+        fd_ = -1;
+        return -1;
+    }
+
+    header_ = static_cast<DetLogSegmentHeader*>(map_);
+    records_ = reinterpret_cast<DetLogRecord*>(static_cast<char*>(map_) + sizeof(DetLogSegmentHeader));
+    std::memset(header_, 0, sizeof(*header_));
+    std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+    header_->version = kVersion;
+    header_->recordSize = sizeof(DetLogRecord);
+    header_->capacity = segmentRecords_;
+    header_->firstTimestampMs = timestampMs;
+
+    indexFile_ = std::fopen(indexPath(path).c_str(), "wb");
+    if (!indexFile_) {
+        std::cerr << "Failed to open detection log index for " << path << std::endl;
+    }
+    return 0;
+}
+
+void DetectionLogWriter::closeSegment() {
+    if (!map_) {
+        return;
+    }
+    uint64_t count = header_->recordCount;
+    msync(map_, mapSize_, MS_SYNC);
+    munmap(map_, mapSize_);
+    // 截断未使用的部分
+    if (ftruncate(fd_, static_cast<off_t>(sizeof(DetLogSegmentHeader) + count * sizeof(DetLogRecord))) != 0) {
+        std::cerr << "Failed to truncate detection log segment: " << std::strerror(errno) << std::endl;
+    }
+    ::close(fd_);
+    if (indexFile_) {
+        std::fclose(indexFile_);
+    }
+    fd_ = -1;
+    map_ = nullptr;
+    header_ = nullptr;
+    records_ = nullptr;
+    indexFile_ = nullptr;
+}
+
+int DetectionLogWriter::append(const std::vector<DetLogRecord>& records) {
+    if (records.empty()) {
+        return 0;
+    }
+    // 一帧的记录时间相同, 每帧只确定一次目录
+    std::string dir = dirFor_ ? dirFor_(records.front().timestampMs) : dir_;
+    if (header_ && dir != segmentDir_) {
+        closeSegment();
+    }
+    for (const auto& record : records) {
+        if (header_ && (header_->recordCount >= header_->capacity ||
+                        record.timestampMs - header_->firstTimestampMs >= segmentSpanMs_)) {
+            closeSegment();
+        }
+        if (!header_ && openSegment(dir, record.timestampMs) != 0) {
+            return -1;
+        }
+
+        uint64_t idx = header_->recordCount;
+        records_[idx] = record;
+        if (idx % indexStride_ == 0 && indexFile_) {
+            DetLogIndexEntry entry{record.timestampMs, record.sequence, idx};
+            std::fwrite(&entry, sizeof(entry), 1, indexFile_);
+        }
+        if (idx == 0) {
+            header_->firstTimestampMs = record.timestampMs;
+            header_->firstSequence = record.sequence;
+        }
+        header_->lastTimestampMs = record.timestampMs;
+        header_->lastSequence = record.sequence;
+        // 记录内容先于记录数对读取端可见
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->recordCount = idx + 1;
+    }
+    return 0;
+}
+
+void DetectionLogWriter::sync() {
+    if (map_) {
+        msync(map_, mapSize_, MS_ASYNC);
+    }
+    if (indexFile_) {
+        std::fflush(indexFile_);
+    }
+}
+
+DetectionLogReader::DetectionLogReader(const std::string& dir) : dir_(dir) {}
+
+int DetectionLogReader::open() {
+    segments_.clear();
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir_, ec)) {
+        if (entry.path().extension() != ".dlog") {
+            continue;
+        }
+        SegmentInfo info;
+        info.path = entry.path().string();
+        int fd = ::open(info.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        bool ok = readHeader(fd, info.header);
+        ::close(fd);
+        if (ok) {
+            segments_.push_back(info);
+        } else {
+            std::cerr << "Skipping invalid detection log segment: " << info.path << std::endl;
+        }
+    }
+    if (ec) {
+        std::cerr << "Failed to list detection log directory " << dir_ << ": " << ec.message() << std::endl;
+        return -1;
+    }
+    // 文件名为定宽的起始时间戳, 按文件名排序即按时间排序, 与所在子目录无关
+    std::sort(segments_.begin(), segments_.end(), [](const SegmentInfo& a, const SegmentInfo& b) {
+        return std::filesystem::path(a.path).filename() < std::filesystem::path(b.path).filename();
+    });
+    return 0;
+}
+
+uint64_t DetectionLogReader::scanTime(int64_t beginMs, int64_t endMs,
+                                      const std::function<bool(const DetLogRecord&)>& fn) const {
+    uint64_t scanned = 0;
+    bool stop = false;
+    for (size_t i = 0; i < segments_.size() && !stop; ++i) {
+        // 段按起始时间排序, 下一段的起始时间即本段的时间上界; 最后一段可能仍在写入
+        const DetLogSegmentHeader& header = segments_[i].header;
+        if (header.firstTimestampMs >= endMs) {
+            break;
+        }
+        if (i + 1 < segments_.size() && segments_[i + 1].header.firstTimestampMs <= beginMs) {
+            continue;
+        }
+        scanned += scanSegment(
+            segments_[i].path, beginMs, endMs, [](const DetLogRecord& r) { return r.timestampMs; },
+            [](const DetLogIndexEntry& e) { return e.timestampMs; }, fn, stop);
+    }
+    return scanned;
+}
+
+uint64_t DetectionLogReader::scanSequence(uint64_t beginSequence, uint64_t endSequence,
+                                          const std::function<bool(const DetLogRecord&)>& fn) const {
+    // 采集序号在进程重启后会重新计数, 所以每个段都需要检查; 段内序号单调不减
+    uint64_t scanned = 0;
+    bool stop = false;
+    for (size_t i = 0; i < segments_.size() && !stop; ++i) {
+        const DetLogSegmentHeader& header = segments_[i].header;
+        if (header.recordCount > 0 && header.firstSequence >= endSequence) {
+            continue;
+        }
+        // 最后一段可能仍在写入, 文件头中的 lastSequence 不可靠
+        if (i + 1 < segments_.size() && header.recordCount > 0 && header.lastSequence < beginSequence) {
+            continue;
+        }
+        scanned += scanSegment(
+            segments_[i].path, beginSequence, endSequence, [](const DetLogRecord& r) { return r.sequence; },
+            [](const DetLogIndexEntry& e) { return e.sequence; }, fn, stop);
+    }
+    return scanned;
+}
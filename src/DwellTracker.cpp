@@ -0,0 +1,37 @@
+#include "DwellTracker.h"
+
+DwellTracker::DwellTracker(size_t capacity, int64_t loiterThresholdMs, int64_t exitGraceMs)
+    : entries_(capacity), loiterThresholdMs_(loiterThresholdMs), exitGraceMs_(exitGraceMs) {}
+
+void DwellTracker::update(int trackId, size_t zoneIdx, int64_t nowMs, std::vector<LoiterEvent>& events) {
+    bool inserted = false;
+    DwellState* state = entries_.insert(makeKey(trackId, zoneIdx), &inserted);
+    if (!state) {
+        dropped_++;
+        return;
+    }
+    if (inserted) {
+        state->enterMs = nowMs;
+    }
+    state->lastSeenMs = nowMs;
+
+    int64_t dwellMs = nowMs - state->enterMs;
+    if (!state->loitering && dwellMs >= loiterThresholdMs_) {
+        state->loitering = true;
+        events.push_back({LoiterEvent::Start, trackId, zoneIdx, state->enterMs, nowMs, dwellMs});
+    }
+}
+
+void DwellTracker::endFrame(int64_t nowMs, std::vector<LoiterEvent>& events) {
+    const int64_t grace = exitGraceMs_;
+    entries_.eraseIf([&events, nowMs, grace](uint64_t key, const DwellState& state) {
+        if (nowMs - state.lastSeenMs <= grace) {
+            return false;
+        }
+        if (state.loitering) {
+            events.push_back({LoiterEvent::End, static_cast<int>(key >> 16), static_cast<size_t>(key & 0xffff),
+                              state.enterMs, state.lastSeenMs, state.lastSeenMs - state.enterMs});
+        }
+        return true;
+    });
+}
@@ -1,6 +1,7 @@
 #include "FileUtils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 unsigned char *load_data(FILE *fp, size_t ofst, size_t sz) {
     unsigned char *data;
@@ -58,3 +59,19 @@ int saveFloat(const char *file_name, float *output, int element_size) {
     fclose(fp);
     return 0;
 }
+
+long resident_kb(void) {
+    FILE *fp;
+    long pages = 0;
+    long resident = 0;
+
+    fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(fp);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -0,0 +1,140 @@
+#include "HeatmapService.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+HeatmapService::HeatmapService(int cellSize, float decay, size_t maxPending)
+    : cellSize_(std::max(1, cellSize)), decay_(decay), maxPending_(std::max<size_t>(1, maxPending)) {}
+
+HeatmapService::~HeatmapService() {
+    stop();
+}
+
+void HeatmapService::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&HeatmapService::worker, this);
+}
+
+void HeatmapService::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    queueCv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void HeatmapService::prepare(const cv::Size& frameSize) {
+    std::lock_guard<std::mutex> lock(heatMtx_);
+    if (frameSize != frameSize_) {
+        resize(frameSize);
+    }
+}
+
+void HeatmapService::submit(const cv::Size& frameSize, const std::vector<cv::Rect_<float>>& boxes) {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMtx_);
+        if (pending_.size() >= maxPending_) {
+            pending_.pop_front();
+        }
+        pending_.push_back({frameSize, boxes});
+    }
+    queueCv_.notify_one();
+}
+
+void HeatmapService::worker() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMtx_);
+            queueCv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+            if (!running_ && pending_.empty()) {
+                return;
+            }
+            job = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        accumulate(job);
+    }
+}
+
+void HeatmapService::resize(const cv::Size& frameSize) {
+    frameSize_ = frameSize;
+    gridW_ = (frameSize.width + cellSize_ - 1) / cellSize_;
+    gridH_ = (frameSize.height + cellSize_ - 1) / cellSize_;
+    diff_.assign(static_cast<size_t>(gridW_ + 1) * (gridH_ + 1), 0.f);
+    heat_.assign(static_cast<size_t>(gridW_) * gridH_, 0.f);
+}
+
+void HeatmapService::accumulate(const Job& job) {
+    std::lock_guard<std::mutex> lock(heatMtx_);
+    if (job.frameSize != frameSize_) {
+        resize(job.frameSize);
+    }
+    if (gridW_ == 0 || gridH_ == 0) {
+        return;
+    }
+
+    // 每个框只改动差分数组的四个角
+    const int stride = gridW_ + 1;
+    std::fill(diff_.begin(), diff_.end(), 0.f);
+    for (const auto& box : job.boxes) {
+        int x0 = std::max(0, static_cast<int>(box.x) / cellSize_);
+        int y0 = std::max(0, static_cast<int>(box.y) / cellSize_);
+        int x1 = std::min(gridW_ - 1, (static_cast<int>(std::ceil(box.x + box.width)) - 1) / cellSize_);
+        int y1 = std::min(gridH_ - 1, (static_cast<int>(std::ceil(box.y + box.height)) - 1) / cellSize_);
+        if (box.width <= 0 || box.height <= 0 || box.x + box.width < 1 || box.y + box.height < 1 || x0 > x1 || y0 > y1) {
+            continue;
+        }
+        diff_[y0 * stride + x0] += 1.f;
+        diff_[y0 * stride + x1 + 1] -= 1.f;
+        diff_[(y1 + 1) * stride + x0] -= 1.f;
+        diff_[(y1 + 1) * stride + x1 + 1] += 1.f;
+    }
+
+    // 二维前缀和还原本帧占用, 同时做指数衰减累加
+    const float gain = 1.f - decay_;
+    for (int y = 0; y < gridH_; ++y) {
+        float* row = &diff_[y * stride];
+        const float* prev = y > 0 ? &diff_[(y - 1) * stride] : nullptr;
+        float rowSum = 0.f;
+        for (int x = 0; x < gridW_; ++x) {
+            rowSum += row[x];
+            // row[x] 就地改写为到 (x, y) 为止的二维前缀和
+            row[x] = rowSum + (prev ? prev[x] : 0.f);
+            float& h = heat_[y * gridW_ + x];
+            h = h * decay_ + row[x] * gain;
+        }
+    }
+}
+
+cv::Mat HeatmapService::snapshot(const cv::Mat& background) {
+    cv::Mat grid;
+    cv::Size frameSize;
+    {
+        std::lock_guard<std::mutex> lock(heatMtx_);
+        if (heat_.empty()) {
+            return cv::Mat();
+        }
+        grid = cv::Mat(gridH_, gridW_, CV_32FC1, heat_.data()).clone();
+        frameSize = frameSize_;
+    }
+
+    cv::Mat gray, colorHeatmap;
+    cv::normalize(grid, gray, 0, 255, cv::NORM_MINMAX, CV_8UC1);
+    cv::resize(gray, gray, frameSize, 0, 0, cv::INTER_LINEAR);
+    cv::applyColorMap(gray, colorHeatmap, cv::COLORMAP_JET);
+
+    if (background.empty() || background.size() != colorHeatmap.size() || background.type() != colorHeatmap.type()) {
+        return colorHeatmap;
+    }
+    cv::Mat blended;
+    cv::addWeighted(background, 0.5, colorHeatmap, 0.5, 0.0, blended);
+    return blended;
+}
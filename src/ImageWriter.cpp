@@ -0,0 +1,124 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <opencv2/imgcodecs.hpp>
+#include "Metrics.h"
+
+ImageWriter::ImageWriter(size_t threadNum, size_t maxPending, ImageFormat format, int quality, BacklogPolicy policy)
+    : format_(format), policy_(policy), maxPending_(std::max<size_t>(1, maxPending)) {
+    switch (format_) {
+    case ImageFormat::JPEG:
+        extension_ = ".jpg";
+        params_ = {cv::IMWRITE_JPEG_QUALITY, std::clamp(quality, 0, 100)};
+        break;
+    case ImageFormat::WEBP:
+        extension_ = ".webp";
+        params_ = {cv::IMWRITE_WEBP_QUALITY, std::clamp(quality, 1, 100)};
+        break;
+    case ImageFormat::PNG:
+        extension_ = ".png";
+        params_ = {cv::IMWRITE_PNG_COMPRESSION, std::clamp(quality, 0, 9)};
+        break;
+    }
+
+    for (size_t i = 0; i < std::max<size_t>(1, threadNum); ++i) {
+        threads_.emplace_back(&ImageWriter::worker, this);
+    }
+}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+bool ImageWriter::write(const std::string& category, const std::string& pathNoExt, const cv::Mat& image) {
+    if (image.empty()) {
+        return false;
+    }
+
+    bool accepted = true;
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        bool queued = false;
+        if (policy_ == BacklogPolicy::Coalesce) {
+            // 同一类别还未编码的旧图像直接被新图像替换
+            auto it = std::find_if(pending_.begin(), pending_.end(),
+                                   [&category](const Job& job) { return job.category == category; });
+            if (it != pending_.end()) {
+                it->path = pathNoExt + extension_;
+                it->image = image;
+                queued = true;
+                Metrics::instance().add("image.coalesced");
+            }
+        }
+        if (!queued) {
+            if (pending_.size() >= maxPending_) {
+                if (policy_ == BacklogPolicy::DropNewest) {
+                    accepted = false;
+                } else {
+                    pending_.pop_front();
+                }
+                Metrics::instance().add("image.dropped");
+            }
+            if (accepted) {
+                pending_.push_back({category, pathNoExt + extension_, image});
+            }
+        }
+        depth = pending_.size();
+    }
+    Metrics::instance().set("image.queue_depth", static_cast<double>(depth));
+    if (accepted) {
+        cv_.notify_one();
+    }
+    return accepted;
+}
+
+void ImageWriter::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    drainedCv_.wait(lock, [this] { return pending_.empty() && busy_ == 0; });
+}
+
+void ImageWriter::worker() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return quit_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return; // quit_ 且队列已空
+            }
+            job = std::move(pending_.front());
+            pending_.pop_front();
+            busy_++;
+        }
+
+        encode(job);
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            busy_--;
+        }
+        drainedCv_.notify_all();
+    }
+}
+
+void ImageWriter::encode(const Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    if (!cv::imwrite(job.path, job.image, params_)) {
+        std::cerr << "Failed to write image: " << job.path << std::endl;
+        Metrics::instance().add("image.failed");
+        return;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    Metrics::instance().observe("image.encode_ms", elapsed.count());
+}
@@ -0,0 +1,65 @@
+#include "LineCounter.h"
+
+// 点 p 相对有向线段 a->b 的叉积, 大于 0 表示在右手侧
+static inline float side(const cv::Point2f& a, const cv::Point2f& b, const cv::Point2f& p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+LineCounter::LineCounter(size_t maxTracks, uint32_t maxMissedFrames)
+    : tracks_(maxTracks), maxMissedFrames_(maxMissedFrames) {}
+
+void LineCounter::setLines(const std::vector<CountLine>& lines) {
+    lines_ = lines;
+    counts_.assign(lines_.size(), LineCount());
+    tracks_.clear();
+}
+
+void LineCounter::beginFrame() {
+    frame_++;
+}
+
+void LineCounter::update(int trackId, const cv::Rect_<float>& box, std::vector<LineCrossing>& crossings) {
+    cv::Point2f centroid(box.x + box.width / 2, box.y + box.height / 2);
+
+    bool inserted = false;
+    TrackState* state = tracks_.insert(static_cast<uint64_t>(trackId), &inserted);
+    if (!state) {
+        return; // 轨迹表已满, 等待淘汰
+    }
+
+    if (!inserted) {
+        const cv::Point2f& prev = state->centroid;
+        for (size_t i = 0; i < lines_.size(); ++i) {
+            const CountLine& line = lines_[i];
+            float before = side(line.p1, line.p2, prev);
+            float after = side(line.p1, line.p2, centroid);
+            bool wasRight = before > 0;
+            bool isRight = after > 0;
+            if (wasRight == isRight) {
+                continue;
+            }
+            // 运动轨迹还必须与线段本身相交, 而不只是穿过其延长线
+            if ((side(prev, centroid, line.p1) > 0) == (side(prev, centroid, line.p2) > 0)) {
+                continue;
+            }
+            bool forward = isRight;
+            if (forward) {
+                counts_[i].forward++;
+            } else {
+                counts_[i].backward++;
+            }
+            crossings.push_back({trackId, i, forward});
+        }
+    }
+
+    state->centroid = centroid;
+    state->lastFrame = frame_;
+}
+
+void LineCounter::endFrame() {
+    const uint32_t frame = frame_;
+    const uint32_t maxMissed = maxMissedFrames_;
+    tracks_.eraseIf([frame, maxMissed](uint64_t, const TrackState& state) {
+        return frame - state.lastFrame > maxMissed;
+    });
+}
@@ -0,0 +1,44 @@
+#include "Metrics.h"
+#include <algorithm>
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::add(const std::string& name, int64_t delta) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    counters_[name] += delta;
+}
+
+void Metrics::set(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    gauges_[name] = value;
+}
+
+void Metrics::observe(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Summary& summary = summaries_[name];
+    summary.count++;
+    summary.sum += value;
+    summary.max = std::max(summary.max, value);
+}
+
+Json::Value Metrics::toJson() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Json::Value root;
+    for (const auto& [name, value] : counters_) {
+        root["counters"][name] = static_cast<Json::Int64>(value);
+    }
+    for (const auto& [name, value] : gauges_) {
+        root["gauges"][name] = value;
+    }
+    for (const auto& [name, summary] : summaries_) {
+        Json::Value item;
+        item["count"] = static_cast<Json::UInt64>(summary.count);
+        item["avg"] = summary.count ? summary.sum / summary.count : 0.0;
+        item["max"] = summary.max;
+        root["summaries"][name] = item;
+    }
+    return root;
+}
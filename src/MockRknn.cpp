@@ -0,0 +1,694 @@
+// 模拟 rknn 运行时: 在没有 NPU 的 x86/ARM Linux 主机上实现程序用到的 rknn API,
+// 用于离线开发和性能回归测试. 以 -DAIBOX_BACKEND=mock 编译时代替 librknnrt 链接.
+//
+// 模型文件是描述输入输出张量的 JSON (示例见 model/mock/), 例如:
+// {
+//     "inputs":  [{ "dims": [1, 640, 640, 3], "fmt": "NHWC" }],
+//     "outputs": [{ "dims": [1, 255, 80, 80], "type": "INT8", "zp": -128, "scale": 0.0039216 }],
+//     "latencyMs": 20,           每次推理模拟的 NPU 耗时, 输出计算耗时计入其中
+//     "jitterMs": 2,             耗时的均匀随机抖动 (± jitterMs)
+//     "npuCores": 3,             进程内可同时推理的上下文数, 取已加载模型中的最大值
+//     "replay": "replay/perdet", 录制的输出目录, 其中 output<i>.bin 为第 i 个输出按原始类型逐帧拼接的数据, 循环使用
+//     "onnx": "yolov5s.onnx",    用 OpenCV DNN 运行的模型, 前向输出按顺序对应 outputs
+//     "synthetic": { ... },      合成目标, 见下
+//     "fill": 0                  以上都没有时输出的常量 (反量化后的值)
+// }
+// 合成目标把按帧移动的框编码成检测头输出, 解码后得到检测结果, 不需要录制数据也能覆盖跟踪、计数和输出路径:
+// "synthetic": {
+//     "layout": "yolov5",        yolov5: 三个 [1, 3 * (5 + 类别数), H / stride, W / stride] 检测头 (PerDet);
+//                                yolov8: [1, 4 + 类别数, 候选框数], 坐标为模型输入像素 (FallDet/FireSmokeDet)
+//     "period": 240,             场景周期 (帧), 同一模型文件的所有上下文共用帧计数
+//     "objects": [{ "class": 0, "score": 0.9, "box": [x, y, w, h], "velocity": [vx, vy], "visible": [from, to] }]
+// }                              box 为第 0 帧的位置 (模型输入像素), 每帧移动 velocity 像素, 碰到边界反弹;
+//                                visible 为周期内可见的帧区间 [from, to), 省略时一直可见
+// 相对路径相对于当前工作目录. 输出类型支持 INT8/UINT8 (affine 量化) 和 FLOAT32, want_float 时按 zp/scale 反量化.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include "rknn_api.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 合成场景中的一个目标
+struct SyntheticObject {
+    int classId = 0;
+    float score = 0.9f;
+    cv::Rect2f box;                 // 第 0 帧的位置, 模型输入像素
+    cv::Point2f velocity;           // 每帧移动的像素
+    int visibleFrom = 0;
+    int visibleTo = -1;             // 小于 0 表示一直可见
+};
+
+// 由模型文件解析出的模型描述, 复制出的上下文共用
+struct MockModel {
+    std::vector<rknn_tensor_attr> inputs;
+    std::vector<rknn_tensor_attr> outputs;
+    double latencyMs = 10;
+    double jitterMs = 0;
+    int npuCores = 3;
+    std::string onnx;
+    std::vector<std::vector<uint8_t>> replay;       // 每个输出的录制数据
+    size_t replayFrames = 0;
+    std::string layout;                              // 合成目标的输出格式, 为空时不合成
+    std::vector<SyntheticObject> objects;
+    int period = 240;
+    std::shared_ptr<std::atomic<uint64_t>> sceneFrames = std::make_shared<std::atomic<uint64_t>>(0);
+    float fill = 0;
+};
+
+struct MockContext {
+    std::shared_ptr<const MockModel> model;
+    cv::dnn::Net net;                                // 每个上下文独立, cv::dnn::Net 不支持并发前向
+    std::vector<uint8_t> input;                      // 最近一次设置的输入
+    std::vector<std::vector<uint8_t>> results;       // 最近一帧的输出, 原始类型
+    std::vector<std::vector<uint8_t>> owned;         // 未预分配时返回给调用方的缓冲区
+    std::future<int> job;                            // 非阻塞运行中的帧
+    uint64_t frames = 0;
+    std::mt19937 rng;
+};
+
+std::mutex registryMtx;
+std::map<rknn_context, std::shared_ptr<MockContext>> contexts;
+rknn_context nextContext = 1;
+
+// 模拟 NPU 核心: 限制同时推理的上下文数
+class NpuCores {
+public:
+    void reserve(int cores) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        capacity_ = std::max(capacity_, cores);
+    }
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return busy_ < capacity_; });
+        busy_++;
+    }
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            busy_--;
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    int capacity_ = 1;
+    int busy_ = 0;
+};
+
+NpuCores npuCores;
+
+std::shared_ptr<MockContext> find(rknn_context ctx) {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    auto it = contexts.find(ctx);
+    return it == contexts.end() ? nullptr : it->second;
+}
+
+rknn_context add(const std::shared_ptr<MockContext>& context) {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    rknn_context id = nextContext++;
+    context->rng.seed(static_cast<uint32_t>(id));
+    contexts[id] = context;
+    return id;
+}
+
+uint32_t typeSize(rknn_tensor_type type) {
+    return type == RKNN_TENSOR_FLOAT32 ? 4 : type == RKNN_TENSOR_FLOAT16 ? 2 : 1;
+}
+
+bool parseTensor(const Json::Value& value, uint32_t index, bool input, rknn_tensor_attr& attr) {
+    memset(&attr, 0, sizeof(attr));
+    const Json::Value& dims = value["dims"];
+    if (!dims.isArray() || dims.empty() || dims.size() > RKNN_MAX_DIMS) {
+        std::cerr << "Mock rknn: tensor " << index << " needs dims" << std::endl;
+        return false;
+    }
+    attr.index = index;
+    attr.n_dims = dims.size();
+    attr.n_elems = 1;
+    for (Json::ArrayIndex i = 0; i < dims.size(); ++i) {
+        if (!dims[i].isUInt() || dims[i].asUInt() == 0) {
+            std::cerr << "Mock rknn: tensor " << index << " has an invalid dimension" << std::endl;
+            return false;
+        }
+        attr.dims[i] = dims[i].asUInt();
+        attr.n_elems *= attr.dims[i];
+    }
+    snprintf(attr.name, RKNN_MAX_NAME_LEN, "%s%u", input ? "input" : "output", index);
+
+    std::string fmt = value.get("fmt", input ? "NHWC" : "NCHW").asString();
+    attr.fmt = fmt == "NHWC" ? RKNN_TENSOR_NHWC : RKNN_TENSOR_NCHW;
+    std::string type = value.get("type", input ? "UINT8" : "FLOAT32").asString();
+    if (type == "INT8") {
+        attr.type = RKNN_TENSOR_INT8;
+    } else if (type == "UINT8") {
+        attr.type = RKNN_TENSOR_UINT8;
+    } else if (type == "FLOAT32") {
+        attr.type = RKNN_TENSOR_FLOAT32;
+    } else {
+        std::cerr << "Mock rknn: unsupported tensor type " << type << std::endl;
+        return false;
+    }
+    attr.qnt_type = attr.type == RKNN_TENSOR_FLOAT32 ? RKNN_TENSOR_QNT_NONE : RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    attr.zp = value.get("zp", 0).asInt();
+    attr.scale = value.get("scale", 1.0).asFloat();
+    attr.size = attr.n_elems * typeSize(attr.type);
+    attr.size_with_stride = attr.size;
+    return true;
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::shared_ptr<MockModel> parseModel(const char* data, size_t size) {
+    Json::Value root;
+    std::string errors;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    if (!reader->parse(data, data + size, &root, &errors) || !root.isObject()) {
+        std::cerr << "Mock rknn: model file is not a JSON model description: " << errors << std::endl;
+        return nullptr;
+    }
+
+    auto model = std::make_shared<MockModel>();
+    const Json::Value& inputs = root["inputs"];
+    const Json::Value& outputs = root["outputs"];
+    if (!inputs.isArray() || inputs.empty() || !outputs.isArray() || outputs.empty()) {
+        std::cerr << "Mock rknn: model needs inputs and outputs" << std::endl;
+        return nullptr;
+    }
+    model->inputs.resize(inputs.size());
+    for (Json::ArrayIndex i = 0; i < inputs.size(); ++i) {
+        if (!parseTensor(inputs[i], i, true, model->inputs[i])) {
+            return nullptr;
+        }
+    }
+    model->outputs.resize(outputs.size());
+    for (Json::ArrayIndex i = 0; i < outputs.size(); ++i) {
+        if (!parseTensor(outputs[i], i, false, model->outputs[i])) {
+            return nullptr;
+        }
+    }
+    model->latencyMs = std::max(0.0, root.get("latencyMs", 10).asDouble());
+    model->jitterMs = std::max(0.0, root.get("jitterMs", 0).asDouble());
+    model->npuCores = std::max(1, root.get("npuCores", 3).asInt());
+    model->onnx = root.get("onnx", "").asString();
+    model->fill = root.get("fill", 0).asFloat();
+
+    const Json::Value& synthetic = root["synthetic"];
+    if (synthetic.isObject()) {
+        model->layout = synthetic.get("layout", "").asString();
+        if (model->layout != "yolov5" && model->layout != "yolov8") {
+            std::cerr << "Mock rknn: synthetic layout must be yolov5 or yolov8" << std::endl;
+            return nullptr;
+        }
+        for (const rknn_tensor_attr& attr : model->outputs) {
+            bool valid = model->layout == "yolov5" ? attr.n_dims == 4 && attr.dims[1] % 3 == 0 && attr.dims[1] / 3 > 5
+                                                   : attr.n_dims == 3 && attr.dims[1] > 4;
+            if (!valid) {
+                std::cerr << "Mock rknn: output " << attr.index << " does not match the " << model->layout << " layout" << std::endl;
+                return nullptr;
+            }
+        }
+        model->period = std::max(1, synthetic.get("period", 240).asInt());
+        for (const Json::Value& item : synthetic["objects"]) {
+            const Json::Value& box = item["box"];
+            if (!box.isArray() || box.size() != 4) {
+                std::cerr << "Mock rknn: synthetic object needs box [x, y, w, h]" << std::endl;
+                return nullptr;
+            }
+            SyntheticObject object;
+            object.classId = item.get("class", 0).asInt();
+            object.score = item.get("score", 0.9).asFloat();
+            object.box = cv::Rect2f(box[0].asFloat(), box[1].asFloat(), box[2].asFloat(), box[3].asFloat());
+            const Json::Value& velocity = item["velocity"];
+            if (velocity.isArray() && velocity.size() == 2) {
+                object.velocity = cv::Point2f(velocity[0].asFloat(), velocity[1].asFloat());
+            }
+            const Json::Value& visible = item["visible"];
+            if (visible.isArray() && visible.size() == 2) {
+                object.visibleFrom = visible[0].asInt();
+                object.visibleTo = visible[1].asInt();
+            }
+            model->objects.push_back(object);
+        }
+    }
+
+    std::string replay = root.get("replay", "").asString();
+    if (!replay.empty()) {
+        model->replay.resize(model->outputs.size());
+        for (size_t i = 0; i < model->outputs.size(); ++i) {
+            std::string path = replay + "/output" + std::to_string(i) + ".bin";
+            uint32_t frameSize = model->outputs[i].size;
+            if (!readFile(path, model->replay[i]) || model->replay[i].empty() || model->replay[i].size() % frameSize != 0) {
+                std::cerr << "Mock rknn: " << path << " must hold whole frames of " << frameSize << " bytes" << std::endl;
+                return nullptr;
+            }
+            size_t frames = model->replay[i].size() / frameSize;
+            model->replayFrames = i == 0 ? frames : std::min(model->replayFrames, frames);
+        }
+    }
+    return model;
+}
+
+int createContext(rknn_context* context, std::shared_ptr<const MockModel> model) {
+    auto mock = std::make_shared<MockContext>();
+    mock->model = std::move(model);
+    if (!mock->model->onnx.empty()) {
+        try {
+            mock->net = cv::dnn::readNet(mock->model->onnx);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Mock rknn: failed to load " << mock->model->onnx << ": " << e.what() << std::endl;
+            return RKNN_ERR_MODEL_INVALID;
+        }
+        if (mock->net.empty()) {
+            std::cerr << "Mock rknn: failed to load " << mock->model->onnx << std::endl;
+            return RKNN_ERR_MODEL_INVALID;
+        }
+    }
+    mock->results.resize(mock->model->outputs.size());
+    for (size_t i = 0; i < mock->results.size(); ++i) {
+        mock->results[i].assign(mock->model->outputs[i].size, 0);
+    }
+    mock->owned.resize(mock->model->outputs.size());
+    npuCores.reserve(mock->model->npuCores);
+    *context = add(mock);
+    return RKNN_SUCC;
+}
+
+// 把反量化后的值写成张量的原始类型
+void quantize(const rknn_tensor_attr& attr, const float* values, uint8_t* out) {
+    if (attr.type == RKNN_TENSOR_FLOAT32) {
+        memcpy(out, values, attr.n_elems * sizeof(float));
+        return;
+    }
+    const float lo = attr.type == RKNN_TENSOR_INT8 ? -128.f : 0.f;
+    const float hi = attr.type == RKNN_TENSOR_INT8 ? 127.f : 255.f;
+    for (uint32_t i = 0; i < attr.n_elems; ++i) {
+        float q = std::min(hi, std::max(lo, std::round(values[i] / attr.scale) + attr.zp));
+        if (attr.type == RKNN_TENSOR_INT8) {
+            reinterpret_cast<int8_t*>(out)[i] = static_cast<int8_t>(q);
+        } else {
+            out[i] = static_cast<uint8_t>(q);
+        }
+    }
+}
+
+void dequantize(const rknn_tensor_attr& attr, const uint8_t* in, float* values) {
+    if (attr.type == RKNN_TENSOR_FLOAT32) {
+        memcpy(values, in, attr.n_elems * sizeof(float));
+        return;
+    }
+    for (uint32_t i = 0; i < attr.n_elems; ++i) {
+        int32_t q = attr.type == RKNN_TENSOR_INT8 ? reinterpret_cast<const int8_t*>(in)[i] : in[i];
+        values[i] = (q - attr.zp) * attr.scale;
+    }
+}
+
+// 匀速移动, 在 [0, range] 内来回反弹
+float bounce(float start, float velocity, uint64_t frame, float range) {
+    if (range <= 0) {
+        return 0;
+    }
+    float pos = std::fmod(start + velocity * static_cast<float>(frame), 2 * range);
+    if (pos < 0) {
+        pos += 2 * range;
+    }
+    return pos > range ? 2 * range - pos : pos;
+}
+
+// 当前帧可见的目标及其位置
+std::vector<SyntheticObject> sceneAt(const MockModel& model, uint64_t frame, const cv::Size& inputSize) {
+    std::vector<SyntheticObject> visible;
+    int phase = static_cast<int>(frame % model.period);
+    for (SyntheticObject object : model.objects) {
+        if (phase < object.visibleFrom || (object.visibleTo >= 0 && phase >= object.visibleTo)) {
+            continue;
+        }
+        object.box.x = bounce(object.box.x, object.velocity.x, frame, inputSize.width - object.box.width);
+        object.box.y = bounce(object.box.y, object.velocity.y, frame, inputSize.height - object.box.height);
+        visible.push_back(object);
+    }
+    return visible;
+}
+
+// 编码为 YOLOv5 检测头 (与 postprocess.cpp 中的解码相反): 选择宽高最接近的 anchor, 目标中心所在的网格写入
+// 偏移、宽高、置信度和类别概率; 输出按 stride 8/16/32 排列
+void encodeYoloV5(const MockModel& model, const std::vector<SyntheticObject>& objects, const cv::Size& inputSize,
+                  std::vector<std::vector<float>>& values) {
+    static const float anchors[3][6] = {{10, 13, 16, 30, 33, 23}, {30, 61, 62, 45, 59, 119}, {116, 90, 156, 198, 373, 326}};
+    for (const SyntheticObject& object : objects) {
+        size_t bestOutput = 0;
+        int bestAnchor = 0;
+        float bestDistance = 1e9f;
+        for (size_t i = 0; i < std::min<size_t>(3, model.outputs.size()); ++i) {
+            for (int a = 0; a < 3; ++a) {
+                float distance = std::fabs(std::log(object.box.width / anchors[i][a * 2])) +
+                                 std::fabs(std::log(object.box.height / anchors[i][a * 2 + 1]));
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestOutput = i;
+                    bestAnchor = a;
+                }
+            }
+        }
+        const rknn_tensor_attr& attr = model.outputs[bestOutput];
+        const int propSize = static_cast<int>(attr.dims[1]) / 3;
+        const int gridH = static_cast<int>(attr.dims[2]);
+        const int gridW = static_cast<int>(attr.dims[3]);
+        const float stride = static_cast<float>(inputSize.height) / gridH;
+        const float cx = (object.box.x + object.box.width / 2) / stride;
+        const float cy = (object.box.y + object.box.height / 2) / stride;
+        const int j = std::min(gridW - 1, std::max(0, static_cast<int>(cx)));
+        const int i = std::min(gridH - 1, std::max(0, static_cast<int>(cy)));
+        if (object.classId < 0 || object.classId >= propSize - 5) {
+            continue;
+        }
+        const int gridLen = gridH * gridW;
+        float* base = values[bestOutput].data() + propSize * bestAnchor * gridLen + i * gridW + j;
+        base[0] = (cx - j + 0.5f) / 2;
+        base[gridLen] = (cy - i + 0.5f) / 2;
+        base[2 * gridLen] = std::min(1.0f, std::sqrt(object.box.width / anchors[bestOutput][bestAnchor * 2]) / 2);
+        base[3 * gridLen] = std::min(1.0f, std::sqrt(object.box.height / anchors[bestOutput][bestAnchor * 2 + 1]) / 2);
+        base[4 * gridLen] = object.score;
+        base[(5 + object.classId) * gridLen] = 1.0f;
+    }
+}
+
+// 编码为 YOLOv8 风格输出 [1, 4 + 类别数, 候选框数]: 每个目标占一个候选框, 其余候选框分数为 0
+void encodeYoloV8(const MockModel& model, const std::vector<SyntheticObject>& objects, std::vector<std::vector<float>>& values) {
+    const rknn_tensor_attr& attr = model.outputs[0];
+    const int features = static_cast<int>(attr.dims[1]);
+    const int boxes = static_cast<int>(attr.dims[2]);
+    for (size_t k = 0; k < objects.size() && static_cast<int>(k) < boxes; ++k) {
+        const SyntheticObject& object = objects[k];
+        if (object.classId < 0 || object.classId >= features - 4) {
+            continue;
+        }
+        float* column = values[0].data() + k;
+        column[0] = object.box.x + object.box.width / 2;
+        column[boxes] = object.box.y + object.box.height / 2;
+        column[2 * boxes] = object.box.width;
+        column[3 * boxes] = object.box.height;
+        column[(4 + object.classId) * boxes] = object.score;
+    }
+}
+
+// 计算一帧的输出
+int compute(MockContext& mock) {
+    const MockModel& model = *mock.model;
+    uint64_t frame = mock.frames++;
+    if (model.replayFrames > 0) {
+        size_t index = frame % model.replayFrames;
+        for (size_t i = 0; i < model.outputs.size(); ++i) {
+            const uint8_t* src = model.replay[i].data() + index * model.outputs[i].size;
+            std::copy(src, src + model.outputs[i].size, mock.results[i].begin());
+        }
+        return RKNN_SUCC;
+    }
+    if (!mock.net.empty()) {
+        const rknn_tensor_attr& in = model.inputs[0];
+        int height = in.fmt == RKNN_TENSOR_NHWC ? in.dims[1] : in.dims[2];
+        int width = in.fmt == RKNN_TENSOR_NHWC ? in.dims[2] : in.dims[3];
+        cv::Mat image(height, width, CV_8UC3, mock.input.data());
+        std::vector<cv::Mat> outs;
+        try {
+            mock.net.setInput(cv::dnn::blobFromImage(image, 1.0 / 255));
+            mock.net.forward(outs, mock.net.getUnconnectedOutLayersNames());
+        } catch (const cv::Exception& e) {
+            std::cerr << "Mock rknn: forward failed: " << e.what() << std::endl;
+            return RKNN_ERR_FAIL;
+        }
+        if (outs.size() < model.outputs.size()) {
+            std::cerr << "Mock rknn: ONNX model has " << outs.size() << " outputs, expected " << model.outputs.size() << std::endl;
+            return RKNN_ERR_OUTPUT_INVALID;
+        }
+        for (size_t i = 0; i < model.outputs.size(); ++i) {
+            if (outs[i].total() != model.outputs[i].n_elems || outs[i].depth() != CV_32F) {
+                std::cerr << "Mock rknn: ONNX output " << i << " does not match the described shape" << std::endl;
+                return RKNN_ERR_OUTPUT_INVALID;
+            }
+            cv::Mat values = outs[i].isContinuous() ? outs[i] : outs[i].clone();
+            quantize(model.outputs[i], values.ptr<float>(), mock.results[i].data());
+        }
+        return RKNN_SUCC;
+    }
+    std::vector<std::vector<float>> values(model.outputs.size());
+    for (size_t i = 0; i < model.outputs.size(); ++i) {
+        values[i].assign(model.outputs[i].n_elems, model.fill);
+    }
+    if (!model.layout.empty()) {
+        const rknn_tensor_attr& in = model.inputs[0];
+        cv::Size inputSize(in.fmt == RKNN_TENSOR_NHWC ? in.dims[2] : in.dims[3],
+                           in.fmt == RKNN_TENSOR_NHWC ? in.dims[1] : in.dims[2]);
+        std::vector<SyntheticObject> objects = sceneAt(model, model.sceneFrames->fetch_add(1), inputSize);
+        if (model.layout == "yolov5") {
+            encodeYoloV5(model, objects, inputSize, values);
+        } else {
+            encodeYoloV8(model, objects, values);
+        }
+    }
+    for (size_t i = 0; i < model.outputs.size(); ++i) {
+        quantize(model.outputs[i], values[i].data(), mock.results[i].data());
+    }
+    return RKNN_SUCC;
+}
+
+// 模拟一次推理: 占用一个 NPU 核心, 计算输出, 补足模拟耗时
+int execute(MockContext& mock) {
+    double latency = mock.model->latencyMs;
+    if (mock.model->jitterMs > 0) {
+        std::uniform_real_distribution<double> jitter(-mock.model->jitterMs, mock.model->jitterMs);
+        latency = std::max(0.0, latency + jitter(mock.rng));
+    }
+    npuCores.acquire();
+    auto start = Clock::now();
+    int ret = compute(mock);
+    std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(latency * 1000)));
+    npuCores.release();
+    return ret;
+}
+
+int waitJob(MockContext& mock) {
+    return mock.job.valid() ? mock.job.get() : RKNN_SUCC;
+}
+
+} // namespace
+
+int rknn_init(rknn_context* context, void* model, uint32_t size, uint32_t flag, rknn_init_extend* extend) {
+    if (!context || !model) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    // 共享权重时直接复用已加载的模型描述
+    if ((flag & RKNN_FLAG_SHARE_WEIGHT_MEM) && extend) {
+        if (std::shared_ptr<MockContext> shared = find(extend->ctx)) {
+            return createContext(context, shared->model);
+        }
+    }
+    std::vector<uint8_t> file;
+    const char* data = static_cast<const char*>(model);
+    if (size == 0) {
+        // size 为 0 时 model 是模型文件路径
+        if (!readFile(data, file)) {
+            std::cerr << "Mock rknn: cannot read " << data << std::endl;
+            return RKNN_ERR_MODEL_INVALID;
+        }
+        data = reinterpret_cast<const char*>(file.data());
+        size = file.size();
+    }
+    std::shared_ptr<MockModel> parsed = parseModel(data, size);
+    return parsed ? createContext(context, parsed) : RKNN_ERR_MODEL_INVALID;
+}
+
+int rknn_dup_context(rknn_context* context_in, rknn_context* context_out) {
+    std::shared_ptr<MockContext> source = context_in ? find(*context_in) : nullptr;
+    if (!source || !context_out) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    return createContext(context_out, source->model);
+}
+
+int rknn_destroy(rknn_context context) {
+    std::shared_ptr<MockContext> mock;
+    {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        auto it = contexts.find(context);
+        if (it == contexts.end()) {
+            return RKNN_ERR_CTX_INVALID;
+        }
+        mock = it->second;
+        contexts.erase(it);
+    }
+    waitJob(*mock);
+    return RKNN_SUCC;
+}
+
+int rknn_query(rknn_context context, rknn_query_cmd cmd, void* info, uint32_t size) {
+    std::shared_ptr<MockContext> mock = find(context);
+    if (!mock) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    const MockModel& model = *mock->model;
+    switch (cmd) {
+    case RKNN_QUERY_IN_OUT_NUM: {
+        if (size < sizeof(rknn_input_output_num)) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        auto* num = static_cast<rknn_input_output_num*>(info);
+        num->n_input = model.inputs.size();
+        num->n_output = model.outputs.size();
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_INPUT_ATTR:
+    case RKNN_QUERY_OUTPUT_ATTR: {
+        if (size < sizeof(rknn_tensor_attr)) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        auto* attr = static_cast<rknn_tensor_attr*>(info);
+        const std::vector<rknn_tensor_attr>& attrs = cmd == RKNN_QUERY_INPUT_ATTR ? model.inputs : model.outputs;
+        if (attr->index >= attrs.size()) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        *attr = attrs[attr->index];
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_SDK_VERSION: {
+        if (size < sizeof(rknn_sdk_version)) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        auto* version = static_cast<rknn_sdk_version*>(info);
+        snprintf(version->api_version, sizeof(version->api_version), "mock");
+        snprintf(version->drv_version, sizeof(version->drv_version), "mock");
+        return RKNN_SUCC;
+    }
+    default:
+        return RKNN_ERR_PARAM_INVALID;
+    }
+}
+
+int rknn_set_core_mask(rknn_context context, rknn_core_mask core_mask) {
+    return find(context) ? RKNN_SUCC : RKNN_ERR_CTX_INVALID;
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t n_inputs, rknn_input inputs[]) {
+    std::shared_ptr<MockContext> mock = find(context);
+    if (!mock) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    const MockModel& model = *mock->model;
+    if (n_inputs != model.inputs.size() || !inputs) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    for (uint32_t i = 0; i < n_inputs; ++i) {
+        if (!inputs[i].buf || inputs[i].size != model.inputs[i].n_elems * typeSize(inputs[i].type)) {
+            std::cerr << "Mock rknn: input " << i << " size " << inputs[i].size << " does not match the model" << std::endl;
+            return RKNN_ERR_INPUT_INVALID;
+        }
+    }
+    // 与运行时一样在这里复制输入, 之后调用方可以复用输入缓冲区; 运行中的帧正在读取输入时先等待其结束
+    if (!mock->net.empty()) {
+        waitJob(*mock);
+    }
+    const uint8_t* buf = static_cast<const uint8_t*>(inputs[0].buf);
+    mock->input.assign(buf, buf + inputs[0].size);
+    return RKNN_SUCC;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend* extend) {
+    std::shared_ptr<MockContext> mock = find(context);
+    if (!mock) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    int ret = waitJob(*mock);
+    if (ret != RKNN_SUCC) {
+        return ret;
+    }
+    if (extend) {
+        extend->frame_id = mock->frames + 1;
+    }
+    if (extend && extend->non_block) {
+        mock->job = std::async(std::launch::async, [mock] { return execute(*mock); });
+        return RKNN_SUCC;
+    }
+    return execute(*mock);
+}
+
+int rknn_wait(rknn_context context, rknn_run_extend* extend) {
+    std::shared_ptr<MockContext> mock = find(context);
+    return mock ? waitJob(*mock) : RKNN_ERR_CTX_INVALID;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs, rknn_output outputs[], rknn_output_extend* extend) {
+    std::shared_ptr<MockContext> mock = find(context);
+    if (!mock) {
+        return RKNN_ERR_CTX_INVALID;
+    }
+    int ret = waitJob(*mock);
+    if (ret != RKNN_SUCC) {
+        return ret;
+    }
+    const MockModel& model = *mock->model;
+    if (n_outputs > model.outputs.size() || !outputs) {
+        return RKNN_ERR_PARAM_INVALID;
+    }
+    for (uint32_t i = 0; i < n_outputs; ++i) {
+        rknn_output& out = outputs[i];
+        const uint32_t index = out.is_prealloc ? out.index : i;
+        if (index >= model.outputs.size()) {
+            return RKNN_ERR_PARAM_INVALID;
+        }
+        const rknn_tensor_attr& attr = model.outputs[index];
+        const uint32_t bytes = out.want_float ? attr.n_elems * sizeof(float) : attr.size;
+        if (out.is_prealloc) {
+            if (!out.buf || out.size < bytes) {
+                return RKNN_ERR_OUTPUT_INVALID;
+            }
+        } else {
+            out.index = index;
+            mock->owned[index].resize(bytes);
+            out.buf = mock->owned[index].data();
+            out.size = bytes;
+        }
+        if (out.want_float) {
+            dequantize(attr, mock->results[index].data(), static_cast<float*>(out.buf));
+        } else {
+            memcpy(out.buf, mock->results[index].data(), bytes);
+        }
+    }
+    if (extend) {
+        extend->frame_id = mock->frames;
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context context, uint32_t n_ouputs, rknn_output outputs[]) {
+    return find(context) ? RKNN_SUCC : RKNN_ERR_CTX_INVALID;
+}
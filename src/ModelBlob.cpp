@@ -0,0 +1,59 @@
+#include "ModelBlob.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include "Metrics.h"
+
+namespace {
+
+std::mutex cacheMtx;
+std::map<std::string, std::weak_ptr<const ModelBlob>> cache;
+
+} // namespace
+
+std::shared_ptr<const ModelBlob> ModelBlob::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cacheMtx);
+    auto it = cache.find(path);
+    if (it != cache.end()) {
+        if (std::shared_ptr<const ModelBlob> blob = it->second.lock()) {
+            Metrics::instance().add("model.blob_hits");
+            return blob;
+        }
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Open file " << path << " failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        std::cerr << "Invalid model file " << path << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // 映射建立后不再需要文件描述符
+    if (data == MAP_FAILED) {
+        std::cerr << "mmap " << path << " failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // rknn_init 会顺序读完整个模型, 提前预读
+    madvise(data, size, MADV_WILLNEED);
+
+    std::shared_ptr<const ModelBlob> blob(new ModelBlob(path, static_cast<unsigned char*>(data), size));
+    cache[path] = blob;
+    Metrics::instance().add("model.blob_maps");
+    return blob;
+}
+
+ModelBlob::~ModelBlob() {
+    munmap(data_, size_);
+}
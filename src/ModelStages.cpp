@@ -0,0 +1,51 @@
+#include "ModelStages.h"
+#include <cstring>
+#include <opencv2/imgproc.hpp>
+#include "preprocess.h"
+
+int ResizePreprocessor::init(const cv::Size& inputSize) {
+    inputSize_ = inputSize;
+    resized_.create(inputSize_, CV_8UC3);
+    rgb_.create(inputSize_, CV_8UC3);
+    return 0;
+}
+
+void* ResizePreprocessor::run(const cv::Mat& image, FrameContext& frame) {
+    frame.srcSize = image.size();
+    frame.scaleW = static_cast<float>(inputSize_.width) / image.cols;
+    frame.scaleH = static_cast<float>(inputSize_.height) / image.rows;
+    frame.pads = BOX_RECT{};
+
+    // 调整图像大小并转换为 RGB 格式, 目标尺寸不变时复用已分配的缓冲区
+    cv::resize(image, resized_, inputSize_);
+    cv::cvtColor(resized_, rgb_, cv::COLOR_BGR2RGB);
+    return rgb_.data;
+}
+
+int RgaResizePreprocessor::init(const cv::Size& inputSize) {
+    inputSize_ = inputSize;
+    resized_.create(inputSize_, CV_8UC3);
+    return 0;
+}
+
+void* RgaResizePreprocessor::run(const cv::Mat& image, FrameContext& frame) {
+    frame.srcSize = image.size();
+    // 计算缩放比例/Calculate the scaling ratio
+    frame.scaleW = static_cast<float>(inputSize_.width) / image.cols;
+    frame.scaleH = static_cast<float>(inputSize_.height) / image.rows;
+    frame.pads = BOX_RECT{};
+
+    cv::cvtColor(image, rgb_, cv::COLOR_BGR2RGB);
+    if (rgb_.size() == inputSize_) {
+        return rgb_.data;
+    }
+    // 图像缩放/Image scaling
+    rga_buffer_t src;
+    rga_buffer_t dst;
+    memset(&src, 0, sizeof(src));
+    memset(&dst, 0, sizeof(dst));
+    if (resize_rga(src, dst, rgb_, resized_, inputSize_) != 0) {
+        fprintf(stderr, "resize with rga error\n");
+    }
+    return resized_.data;
+}
@@ -0,0 +1,111 @@
+#include "OverlayRenderer.h"
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+#include "Metrics.h"
+
+void OverlayRenderer::begin(const cv::Mat& frame) {
+    frame_ = frame;
+    items_.clear();
+    rendered_.clear();
+    frameRenderMs_ = 0;
+}
+
+void OverlayRenderer::addBox(uint32_t layer, const cv::Rect_<float>& box, const std::string& label, int colorId) {
+    if (headless_) {
+        return;
+    }
+    Item item{};
+    item.kind = Item::Box;
+    item.layer = layer;
+    item.box = box;
+    item.text = label;
+    item.color = cv::Scalar((colorId * 123) % 256, (colorId * 456) % 256, (colorId * 789) % 256);
+    items_.push_back(std::move(item));
+}
+
+void OverlayRenderer::addPolygon(uint32_t layer, const std::vector<cv::Point>* polygon) {
+    if (headless_ || !polygon || polygon->empty()) {
+        return;
+    }
+    Item item{};
+    item.kind = Item::Polygon;
+    item.layer = layer;
+    item.polygon = polygon;
+    item.color = cv::Scalar(0, 255, 0);
+    items_.push_back(std::move(item));
+}
+
+void OverlayRenderer::addText(uint32_t layer, const std::string& text, cv::Point origin, double scale, int thickness) {
+    if (headless_) {
+        return;
+    }
+    Item item{};
+    item.kind = Item::Text;
+    item.layer = layer;
+    item.text = text;
+    item.origin = origin;
+    item.scale = scale;
+    item.thickness = thickness;
+    item.color = cv::Scalar(255, 255, 255);
+    items_.push_back(std::move(item));
+}
+
+cv::Mat OverlayRenderer::render(uint32_t layers) {
+    if (headless_ || frame_.empty()) {
+        return cv::Mat();
+    }
+    for (const auto& rendered : rendered_) {
+        if (rendered.first == layers) {
+            return rendered.second;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat image = frame_.clone();
+    for (const auto& item : items_) {
+        if (item.layer & layers) {
+            draw(image, item);
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    frameRenderMs_ += elapsed.count();
+
+    rendered_.emplace_back(layers, image);
+    return image;
+}
+
+void OverlayRenderer::end() {
+    if (!rendered_.empty()) {
+        Metrics::instance().observe("render.frame_ms", frameRenderMs_);
+        Metrics::instance().add("render.images", static_cast<int64_t>(rendered_.size()));
+    } else {
+        Metrics::instance().add("render.skipped");
+    }
+    // 释放对原图和渲染结果的引用
+    frame_ = cv::Mat();
+    rendered_.clear();
+}
+
+void OverlayRenderer::draw(cv::Mat& image, const Item& item) const {
+    switch (item.kind) {
+    case Item::Box: {
+        int baseline = 0;
+        cv::Size textSize = cv::getTextSize(item.text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
+        cv::Point textOrigin(item.box.x, item.box.y);
+        cv::rectangle(image, cv::Rect(textOrigin, textSize), item.color, cv::FILLED);
+        cv::putText(image, item.text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                    cv::Scalar(255, 255, 255));
+        cv::rectangle(image, item.box, item.color, 1);
+        break;
+    }
+    case Item::Polygon: {
+        const cv::Point* points[1] = {item.polygon->data()};
+        int numberOfPoints[] = {static_cast<int>(item.polygon->size())};
+        cv::polylines(image, points, numberOfPoints, 1, true, item.color, 2, cv::LINE_AA);
+        break;
+    }
+    case Item::Text:
+        cv::putText(image, item.text, item.origin, cv::FONT_HERSHEY_SIMPLEX, item.scale, item.color, item.thickness);
+        break;
+    }
+}
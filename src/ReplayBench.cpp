@@ -0,0 +1,189 @@
+#include "ReplayBench.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+
+namespace {
+
+double elapsedMs(ReplayBench::Clock::time_point from, ReplayBench::Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// 最近秩法取分位数, samples 已排序
+double percentile(const std::vector<double>& samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+    return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+double timevalMs(const timeval& tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+} // namespace
+
+ReplayBench& ReplayBench::instance() {
+    static ReplayBench bench;
+    return bench;
+}
+
+void ReplayBench::start(const std::string& reportPath, double rate, const Json::Value& info) {
+    reportPath_ = reportPath;
+    rate_ = std::max(0.0, rate);
+    info_ = info;
+    enabled_ = true;
+}
+
+void ReplayBench::frameCaptured(uint64_t frameID) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (captured_ == 0) {
+        firstCapture_ = now;
+    }
+    // 帧ID循环使用, 覆盖同ID的旧记录 (旧帧已丢弃)
+    frames_[frameID] = FrameTimes{now, {}, {}, {}};
+    captured_++;
+}
+
+void ReplayBench::inferStarted(uint64_t frameID) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = frames_.find(frameID);
+    if (it != frames_.end() && it->second.inferStarted == Clock::time_point{}) {
+        it->second.inferStarted = now;
+        observeLocked("queue", it->second.captured, now);
+    }
+}
+
+void ReplayBench::inferFinished(uint64_t frameID) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = frames_.find(frameID);
+    if (it != frames_.end()) {
+        it->second.inferFinished = std::max(it->second.inferFinished, now);
+    }
+}
+
+void ReplayBench::resultStarted(uint64_t frameID) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = frames_.find(frameID);
+    if (it != frames_.end()) {
+        it->second.resultStarted = now;
+        // 汇总线程取到这一帧时各模型都已发布结果 (或已超时), 此时才能确定最后一个模型的完成时间
+        if (it->second.inferStarted != Clock::time_point{} && it->second.inferFinished != Clock::time_point{}) {
+            observeLocked("infer", it->second.inferStarted, it->second.inferFinished);
+            observeLocked("wait", it->second.inferFinished, now);
+        }
+    }
+}
+
+void ReplayBench::resultFinished(uint64_t frameID) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = frames_.find(frameID);
+    if (it == frames_.end()) {
+        return;
+    }
+    observeLocked("aggregate", it->second.resultStarted, now);
+    observeLocked("e2e", it->second.captured, now);
+    frames_.erase(it);
+    lastFinish_ = now;
+    finished_++;
+}
+
+void ReplayBench::observe(const std::string& stage, double ms) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    samples_[stage].push_back(ms);
+}
+
+void ReplayBench::observeLocked(const std::string& stage, Clock::time_point from, Clock::time_point to) {
+    samples_[stage].push_back(elapsedMs(from, to));
+}
+
+void ReplayBench::chargeCpu(const std::string& stage, double& lastCpuMs) {
+    double now = threadCpuMs();
+    std::lock_guard<std::mutex> lock(mtx_);
+    cpuMs_[stage] += now - lastCpuMs;
+    lastCpuMs = now;
+}
+
+void ReplayBench::addDrops(const std::string& reason, uint64_t count) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    drops_[reason] += count;
+}
+
+double ReplayBench::threadCpuMs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int ReplayBench::writeReport(const Json::Value& metrics) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Json::Value root;
+    root["info"] = info_;
+    root["rate"] = rate_;
+
+    const uint64_t finished = finished_;
+    const double elapsedSec = finished > 0 ? elapsedMs(firstCapture_, lastFinish_) / 1000.0 : 0.0;
+    root["frames"]["captured"] = static_cast<Json::UInt64>(captured_.load());
+    root["frames"]["completed"] = static_cast<Json::UInt64>(finished);
+    root["elapsedSec"] = elapsedSec;
+    root["fps"] = elapsedSec > 0 ? finished / elapsedSec : 0.0;
+
+    for (auto& [stage, samples] : samples_) {
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        Json::Value item;
+        item["count"] = static_cast<Json::UInt64>(samples.size());
+        item["mean"] = samples.empty() ? 0.0 : sum / samples.size();
+        item["p50"] = percentile(samples, 50);
+        item["p95"] = percentile(samples, 95);
+        item["p99"] = percentile(samples, 99);
+        item["max"] = samples.empty() ? 0.0 : samples.back();
+        root["latencyMs"][stage] = item;
+    }
+
+    for (const auto& [stage, ms] : cpuMs_) {
+        root["cpuMs"][stage] = ms;
+        root["cpuMsPerFrame"][stage] = finished > 0 ? ms / finished : 0.0;
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    root["cpuMs"]["process.user"] = timevalMs(usage.ru_utime);
+    root["cpuMs"]["process.system"] = timevalMs(usage.ru_stime);
+    root["peakRssMB"] = usage.ru_maxrss / 1024.0;
+
+    // 各模块的丢弃计数 (如 image.dropped、db.dropped) 与队列溢出一起汇总
+    Json::Value drops(Json::objectValue);
+    for (const auto& [reason, count] : drops_) {
+        drops[reason] = static_cast<Json::UInt64>(count);
+    }
+    const Json::Value& counters = metrics["counters"];
+    for (const auto& name : counters.getMemberNames()) {
+        if (name.size() > 8 && name.compare(name.size() - 8, 8, ".dropped") == 0) {
+            drops[name] = counters[name];
+        }
+    }
+    root["drops"] = drops;
+    root["metrics"] = metrics;
+
+    std::ofstream file(reportPath_);
+    if (!file) {
+        std::cerr << "Failed to write benchmark report: " << reportPath_ << std::endl;
+        return -1;
+    }
+    file << root.toStyledString();
+    std::cout << "\nBenchmark report written to " << reportPath_ << ": " << finished << " frames, "
+              << root["fps"].asDouble() << " fps" << std::endl;
+    return 0;
+}
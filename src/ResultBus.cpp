@@ -0,0 +1,272 @@
+#include "ResultBus.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Metrics.h"
+#include "ResultSerializer.h"
+
+ResultBus::~ResultBus() {
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        subscribers.swap(subscribers_);
+    }
+    for (const auto& subscriber : subscribers) {
+        stopSubscriber(subscriber);
+    }
+}
+
+int ResultBus::subscribe(const std::string& name, Callback callback, size_t capacity, bool wantPayload) {
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->name = name;
+    subscriber->callback = std::move(callback);
+    subscriber->capacity = std::max<size_t>(1, capacity);
+    subscriber->wantPayload = wantPayload;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    subscriber->id = nextId_++;
+    subscriber->thread = std::thread(&ResultBus::deliverLoop, this, subscriber.get());
+    subscribers_.push_back(subscriber);
+    return subscriber->id;
+}
+
+void ResultBus::unsubscribe(int id) {
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = std::find_if(subscribers_.begin(), subscribers_.end(),
+                               [id](const std::shared_ptr<Subscriber>& s) { return s->id == id; });
+        if (it == subscribers_.end()) {
+            return;
+        }
+        subscriber = *it;
+        subscribers_.erase(it);
+    }
+    stopSubscriber(subscriber);
+}
+
+size_t ResultBus::subscriberCount() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return subscribers_.size();
+}
+
+void ResultBus::stopSubscriber(const std::shared_ptr<Subscriber>& subscriber) {
+    {
+        std::lock_guard<std::mutex> lock(subscriber->mtx);
+        subscriber->quit = true;
+    }
+    subscriber->cv.notify_all();
+    if (subscriber->thread.joinable()) {
+        subscriber->thread.join();
+    }
+}
+
+void ResultBus::publish(uint64_t frameID, int64_t captureMs, std::shared_ptr<const Json::Value> root) {
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    std::vector<std::shared_ptr<Subscriber>> finished;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        // 顺便移除已结束的订阅者
+        for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+            if ((*it)->finished) {
+                finished.push_back(*it);
+                it = subscribers_.erase(it);
+            } else {
+                subscribers.push_back(*it);
+                ++it;
+            }
+        }
+    }
+    for (const auto& subscriber : finished) {
+        stopSubscriber(subscriber);
+    }
+    if (subscribers.empty()) {
+        return;
+    }
+
+    auto message = std::make_shared<ResultMessage>();
+    message->frameID = frameID;
+    message->captureMs = captureMs;
+    message->root = std::move(root);
+    // 编码只做一次, 所有需要的订阅者共享
+    bool wantPayload = std::any_of(subscribers.begin(), subscribers.end(),
+                                   [](const std::shared_ptr<Subscriber>& s) { return s->wantPayload; });
+    if (wantPayload && message->root) {
+        auto payload = std::make_shared<std::string>();
+        ResultSerializer::writeMsgPack(*message->root, *payload);
+        message->payload = std::move(payload);
+    }
+    message->publishTime = std::chrono::steady_clock::now();
+    std::shared_ptr<const ResultMessage> shared = std::move(message);
+
+    for (const auto& subscriber : subscribers) {
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mtx);
+            if (subscriber->queue.size() >= subscriber->capacity) {
+                subscriber->queue.pop_front();
+                dropped = true;
+            }
+            subscriber->queue.push_back(shared);
+        }
+        if (dropped) {
+            Metrics::instance().add("bus." + subscriber->name + ".dropped");
+        }
+        subscriber->cv.notify_one();
+    }
+}
+
+void ResultBus::deliverLoop(Subscriber* subscriber) {
+    const std::string latencyName = "bus." + subscriber->name + ".latency_ms";
+    const std::string ageName = "bus." + subscriber->name + ".age_ms";
+    while (true) {
+        std::shared_ptr<const ResultMessage> message;
+        {
+            std::unique_lock<std::mutex> lock(subscriber->mtx);
+            subscriber->cv.wait(lock, [subscriber] { return subscriber->quit || !subscriber->queue.empty(); });
+            if (subscriber->quit) {
+                return;
+            }
+            message = std::move(subscriber->queue.front());
+            subscriber->queue.pop_front();
+        }
+
+        // 发布到投递的延迟, 以及从采集到投递的总延迟
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - message->publishTime;
+        int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        Metrics::instance().observe(latencyName, latency.count());
+        Metrics::instance().observe(ageName, static_cast<double>(nowMs - message->captureMs));
+
+        if (!subscriber->callback(*message)) {
+            subscriber->finished = true;
+            return;
+        }
+    }
+}
+
+ResultBusSocketServer::ResultBusSocketServer(ResultBus& bus, const std::string& path, size_t clientQueue)
+    : bus_(bus), path_(path), clientQueue_(clientQueue) {}
+
+ResultBusSocketServer::~ResultBusSocketServer() {
+    stop();
+}
+
+int ResultBusSocketServer::start() {
+    sockaddr_un addr{};
+    if (path_.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Result bus socket path too long: " << path_ << std::endl;
+        return -1;
+    }
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        std::cerr << "Failed to create result bus socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path_.c_str());
+    if (bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenFd_, 8) != 0) {
+        std::cerr << "Failed to listen on " << path_ << ": " << std::strerror(errno) << std::endl;
+        close(listenFd_);
+        listenFd_ = -1;
+        return -1;
+    }
+    quit_ = false;
+    acceptThread_ = std::thread(&ResultBusSocketServer::acceptLoop, this);
+    return 0;
+}
+
+void ResultBusSocketServer::stop() {
+    if (listenFd_ < 0) {
+        return;
+    }
+    quit_ = true;
+    // 唤醒阻塞在 accept 上的线程
+    shutdown(listenFd_, SHUT_RDWR);
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    close(listenFd_);
+    listenFd_ = -1;
+    unlink(path_.c_str());
+
+    std::vector<int> clients;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        clients.swap(clients_);
+    }
+    for (int id : clients) {
+        bus_.unsubscribe(id);
+    }
+}
+
+void ResultBusSocketServer::acceptLoop() {
+    while (!quit_) {
+        int fd = accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        // 客户端长时间不读时写操作超时, 连接被断开, 不会拖住投递线程
+        timeval timeout{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // fd 由回调持有, 订阅者移除时随回调一起释放
+        auto socketFd = std::shared_ptr<int>(new int(fd), [](int* p) {
+            close(*p);
+            delete p;
+        });
+        int id = bus_.subscribe("socket", [socketFd](const ResultMessage& message) {
+            if (!message.payload) {
+                return true;
+            }
+            uint32_t size = static_cast<uint32_t>(message.payload->size());
+            unsigned char header[4] = {static_cast<unsigned char>(size >> 24), static_cast<unsigned char>(size >> 16),
+                                       static_cast<unsigned char>(size >> 8), static_cast<unsigned char>(size)};
+            iovec iov[2] = {{header, sizeof(header)},
+                            {const_cast<char*>(message.payload->data()), message.payload->size()}};
+            size_t total = sizeof(header) + message.payload->size();
+            size_t sent = 0;
+            while (sent < total) {
+                msghdr msg{};
+                // 跳过已发送的部分
+                iovec parts[2];
+                int count = 0;
+                size_t skip = sent;
+                for (const auto& part : iov) {
+                    if (skip >= part.iov_len) {
+                        skip -= part.iov_len;
+                        continue;
+                    }
+                    parts[count].iov_base = static_cast<char*>(part.iov_base) + skip;
+                    parts[count].iov_len = part.iov_len - skip;
+                    skip = 0;
+                    count++;
+                }
+                msg.msg_iov = parts;
+                msg.msg_iovlen = count;
+                ssize_t n = sendmsg(*socketFd, &msg, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    Metrics::instance().add("bus.socket.disconnected");
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }, clientQueue_, true);
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        clients_.push_back(id);
+        Metrics::instance().add("bus.socket.connected");
+    }
+}
@@ -0,0 +1,316 @@
+#include "ResultSerializer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void appendEscaped(const char* str, size_t len, std::string& out) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                out.append("\\u00");
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 0xf]);
+            } else {
+                out.push_back(static_cast<char>(c));
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void appendJson(const Json::Value& value, std::string& out) {
+    char buf[32];
+    switch (value.type()) {
+    case Json::nullValue:
+        out.append("null");
+        break;
+    case Json::intValue:
+        out.append(buf, std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value.asLargestInt())));
+        break;
+    case Json::uintValue:
+        out.append(buf, std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(value.asLargestUInt())));
+        break;
+    case Json::realValue: {
+        double d = value.asDouble();
+        if (!std::isfinite(d)) {
+            out.append("null");
+            break;
+        }
+        // 与 jsoncpp 相同的精度, 保证数值可以无损还原
+        int n = std::snprintf(buf, sizeof(buf), "%.17g", d);
+        out.append(buf, n);
+        if (!std::strpbrk(buf, ".eE")) {
+            out.append(".0");
+        }
+        break;
+    }
+    case Json::stringValue: {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        value.getString(&begin, &end);
+        appendEscaped(begin, end - begin, out);
+        break;
+    }
+    case Json::booleanValue:
+        out.append(value.asBool() ? "true" : "false");
+        break;
+    case Json::arrayValue: {
+        out.push_back('[');
+        for (Json::ArrayIndex i = 0; i < value.size(); ++i) {
+            if (i) {
+                out.push_back(',');
+            }
+            appendJson(value[i], out);
+        }
+        out.push_back(']');
+        break;
+    }
+    case Json::objectValue: {
+        out.push_back('{');
+        bool first = true;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (!first) {
+                out.push_back(',');
+            }
+            first = false;
+            const char* end = nullptr;
+            const char* key = it.memberName(&end);
+            appendEscaped(key, end - key, out);
+            out.push_back(':');
+            appendJson(*it, out);
+        }
+        out.push_back('}');
+        break;
+    }
+    }
+}
+
+// MessagePack 使用大端字节序
+void appendBigEndian(uint64_t v, int bytes, std::string& out) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<char>((v >> (i * 8)) & 0xff));
+    }
+}
+
+void appendMsgPackString(const char* str, size_t len, std::string& out) {
+    if (len < 32) {
+        out.push_back(static_cast<char>(0xa0 | len));
+    } else if (len <= 0xff) {
+        out.push_back(static_cast<char>(0xd9));
+        appendBigEndian(len, 1, out);
+    } else if (len <= 0xffff) {
+        out.push_back(static_cast<char>(0xda));
+        appendBigEndian(len, 2, out);
+    } else {
+        out.push_back(static_cast<char>(0xdb));
+        appendBigEndian(len, 4, out);
+    }
+    out.append(str, len);
+}
+
+void appendMsgPackContainer(size_t size, bool map, std::string& out) {
+    if (size < 16) {
+        out.push_back(static_cast<char>((map ? 0x80 : 0x90) | size));
+    } else if (size <= 0xffff) {
+        out.push_back(static_cast<char>(map ? 0xde : 0xdc));
+        appendBigEndian(size, 2, out);
+    } else {
+        out.push_back(static_cast<char>(map ? 0xdf : 0xdd));
+        appendBigEndian(size, 4, out);
+    }
+}
+
+void appendMsgPackUInt(uint64_t v, std::string& out) {
+    if (v < 0x80) {
+        out.push_back(static_cast<char>(v));
+    } else if (v <= 0xff) {
+        out.push_back(static_cast<char>(0xcc));
+        appendBigEndian(v, 1, out);
+    } else if (v <= 0xffff) {
+        out.push_back(static_cast<char>(0xcd));
+        appendBigEndian(v, 2, out);
+    } else if (v <= 0xffffffffULL) {
+        out.push_back(static_cast<char>(0xce));
+        appendBigEndian(v, 4, out);
+    } else {
+        out.push_back(static_cast<char>(0xcf));
+        appendBigEndian(v, 8, out);
+    }
+}
+
+void appendMsgPack(const Json::Value& value, std::string& out) {
+    switch (value.type()) {
+    case Json::nullValue:
+        out.push_back(static_cast<char>(0xc0));
+        break;
+    case Json::intValue: {
+        int64_t v = value.asLargestInt();
+        if (v >= 0) {
+            appendMsgPackUInt(static_cast<uint64_t>(v), out);
+        } else if (v >= -32) {
+            out.push_back(static_cast<char>(v));
+        } else if (v >= INT8_MIN) {
+            out.push_back(static_cast<char>(0xd0));
+            appendBigEndian(static_cast<uint8_t>(v), 1, out);
+        } else if (v >= INT16_MIN) {
+            out.push_back(static_cast<char>(0xd1));
+            appendBigEndian(static_cast<uint16_t>(v), 2, out);
+        } else if (v >= INT32_MIN) {
+            out.push_back(static_cast<char>(0xd2));
+            appendBigEndian(static_cast<uint32_t>(v), 4, out);
+        } else {
+            out.push_back(static_cast<char>(0xd3));
+            appendBigEndian(static_cast<uint64_t>(v), 8, out);
+        }
+        break;
+    }
+    case Json::uintValue:
+        appendMsgPackUInt(value.asLargestUInt(), out);
+        break;
+    case Json::realValue: {
+        double d = value.asDouble();
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        out.push_back(static_cast<char>(0xcb));
+        appendBigEndian(bits, 8, out);
+        break;
+    }
+    case Json::stringValue: {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        value.getString(&begin, &end);
+        appendMsgPackString(begin, end - begin, out);
+        break;
+    }
+    case Json::booleanValue:
+        out.push_back(static_cast<char>(value.asBool() ? 0xc3 : 0xc2));
+        break;
+    case Json::arrayValue:
+        appendMsgPackContainer(value.size(), false, out);
+        for (Json::ArrayIndex i = 0; i < value.size(); ++i) {
+            appendMsgPack(value[i], out);
+        }
+        break;
+    case Json::objectValue:
+        appendMsgPackContainer(value.size(), true, out);
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            const char* end = nullptr;
+            const char* key = it.memberName(&end);
+            appendMsgPackString(key, end - key, out);
+            appendMsgPack(*it, out);
+        }
+        break;
+    }
+}
+
+} // namespace
+
+ResultSerializer::ResultSerializer(ResultEncoding encoding) : encoding_(encoding) {
+}
+
+void ResultSerializer::reset() {
+    fieldCount_ = 0;
+}
+
+const std::string& ResultSerializer::add(const std::string& key, const Json::Value& value) {
+    std::pair<std::string, std::string>* field = nullptr;
+    for (size_t i = 0; i < fieldCount_; ++i) {
+        if (fields_[i].first == key) {
+            field = &fields_[i];
+            break;
+        }
+    }
+    if (!field) {
+        if (fieldCount_ == fields_.size()) {
+            fields_.emplace_back();
+        }
+        field = &fields_[fieldCount_++];
+        field->first = key;
+    }
+    // 复用上一帧片段的容量
+    field->second.clear();
+    writeValue(value, field->second);
+    return field->second;
+}
+
+std::shared_ptr<const std::string> ResultSerializer::finish(const Json::Value& root) {
+    auto out = std::make_shared<std::string>();
+    out->reserve(lastSize_);
+
+    if (encoding_ == ResultEncoding::MsgPack) {
+        appendMsgPackContainer(root.size(), true, *out);
+    } else {
+        out->push_back('{');
+    }
+
+    bool first = true;
+    for (auto it = root.begin(); it != root.end(); ++it) {
+        if (encoding_ == ResultEncoding::Json && !first) {
+            out->push_back(',');
+        }
+        first = false;
+
+        const char* end = nullptr;
+        const char* key = it.memberName(&end);
+        size_t len = end - key;
+        writeKey(key, len, *out);
+
+        const std::string* piece = nullptr;
+        for (size_t i = 0; i < fieldCount_; ++i) {
+            if (fields_[i].first.size() == len && std::memcmp(fields_[i].first.data(), key, len) == 0) {
+                piece = &fields_[i].second;
+                break;
+            }
+        }
+        if (piece) {
+            out->append(*piece);
+        } else {
+            writeValue(*it, *out);
+        }
+    }
+
+    if (encoding_ == ResultEncoding::Json) {
+        out->push_back('}');
+    }
+    lastSize_ = out->size();
+    return out;
+}
+
+void ResultSerializer::writeJson(const Json::Value& value, std::string& out) {
+    appendJson(value, out);
+}
+
+void ResultSerializer::writeMsgPack(const Json::Value& value, std::string& out) {
+    appendMsgPack(value, out);
+}
+
+void ResultSerializer::writeValue(const Json::Value& value, std::string& out) const {
+    if (encoding_ == ResultEncoding::MsgPack) {
+        appendMsgPack(value, out);
+    } else {
+        appendJson(value, out);
+    }
+}
+
+void ResultSerializer::writeKey(const char* key, size_t len, std::string& out) const {
+    if (encoding_ == ResultEncoding::MsgPack) {
+        appendMsgPackString(key, len, out);
+    } else {
+        appendEscaped(key, len, out);
+        out.push_back(':');
+    }
+}
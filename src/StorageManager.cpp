@@ -0,0 +1,333 @@
+#include "StorageManager.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include "DatabaseManager.h"
+#include "Metrics.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int64_t kHourMs = 3600 * 1000;
+const int64_t kDayMs = 24 * kHourMs;
+// 小时结束后再等一段时间才认为分片不再变化, 覆盖异步写盘的延迟
+const int64_t kSealDelayMs = 10 * 60 * 1000;
+const int64_t kPruneIntervalMs = kHourMs;
+
+// linux/ioprio.h
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::tm localTime(int64_t ms) {
+    std::time_t t = static_cast<std::time_t>(ms / 1000);
+    std::tm local{};
+    localtime_r(&t, &local);
+    return local;
+}
+
+// 本地时间的 YYYYMMDDHH, 按数值大小即按时间先后排序
+int64_t hourKey(const std::tm& local) {
+    return (local.tm_year + 1900) * 1000000LL + (local.tm_mon + 1) * 10000LL + local.tm_mday * 100LL + local.tm_hour;
+}
+
+int64_t hourKey(int64_t ms) {
+    return hourKey(localTime(ms));
+}
+
+bool allDigits(const std::string& name, size_t length) {
+    if (name.size() != length) {
+        return false;
+    }
+    for (char c : name) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 清理线程只在空闲时占用 CPU 和磁盘
+void lowerThreadPriority() {
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+} // namespace
+
+StorageManager::StorageManager(const std::string& root, uint64_t quotaBytes, int retentionDays, int scanIntervalMs)
+    : root_(root), quotaBytes_(quotaBytes), retentionDays_(retentionDays), scanIntervalMs_(scanIntervalMs) {
+}
+
+StorageManager::~StorageManager() {
+    stop();
+}
+
+void StorageManager::addCategory(const std::string& category) {
+    categories_.push_back(category);
+}
+
+void StorageManager::setDatabase(DatabaseManager* db, int retentionDays, int rollupRetentionDays) {
+    db_ = db;
+    dbRetentionDays_ = retentionDays;
+    rollupRetentionDays_ = rollupRetentionDays;
+}
+
+int StorageManager::start() {
+    if (worker_.joinable()) {
+        return 0;
+    }
+    std::error_code ec;
+    fs::create_directories(root_, ec);
+    if (ec) {
+        std::cerr << "Failed to create output directory " << root_ << ": " << ec.message() << std::endl;
+        return -1;
+    }
+    quit_ = false;
+    worker_ = std::thread(&StorageManager::run, this);
+    return 0;
+}
+
+void StorageManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+std::string StorageManager::pathFor(const std::string& category, int64_t timestampMs, uint64_t frameID) {
+    std::tm local = localTime(timestampMs);
+    std::string dir = dirFor(category, timestampMs);
+
+    char name[64];
+    size_t length = std::strftime(name, sizeof(name), "%Y%m%d%H%M%S", &local);
+    std::snprintf(name + length, sizeof(name) - length, "_%llu", static_cast<unsigned long long>(frameID));
+    return dir + "/" + name;
+}
+
+std::string StorageManager::dirFor(const std::string& category, int64_t timestampMs) {
+    ShardKey key(hourKey(timestampMs), category);
+    std::string dir = shardDir(key);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = currentHour_.find(category);
+        if (it == currentHour_.end() || it->second != key.first) {
+            // 每个类别每小时只创建一次目录
+            std::error_code ec;
+            fs::create_directories(dir, ec);
+            if (ec) {
+                std::cerr << "Failed to create directory " << dir << ": " << ec.message() << std::endl;
+            }
+            currentHour_[category] = key.first;
+            newShards_.push_back(key);
+        }
+    }
+    return dir;
+}
+
+std::string StorageManager::shardDir(const ShardKey& key) const {
+    std::string dir = root_ + "/" + key.second;
+    if (key.first == 0) {
+        return dir;
+    }
+    char shard[16];
+    std::snprintf(shard, sizeof(shard), "/%08lld/%02lld", static_cast<long long>(key.first / 100),
+                  static_cast<long long>(key.first % 100));
+    return dir + shard;
+}
+
+void StorageManager::scanAll() {
+    const int64_t sealedBefore = hourKey(nowMs() - kSealDelayMs);
+    for (const auto& category : categories_) {
+        std::error_code ec;
+        fs::path categoryDir = fs::path(root_) / category;
+        fs::create_directories(categoryDir, ec);
+        for (const auto& dateEntry : fs::directory_iterator(categoryDir, ec)) {
+            const std::string dateName = dateEntry.path().filename().string();
+            if (!dateEntry.is_directory(ec)) {
+                continue;
+            }
+            if (!allDigits(dateName, 8)) {
+                continue;
+            }
+            std::error_code hourEc;
+            for (const auto& hourEntry : fs::directory_iterator(dateEntry.path(), hourEc)) {
+                const std::string hourName = hourEntry.path().filename().string();
+                if (!hourEntry.is_directory(hourEc) || !allDigits(hourName, 2)) {
+                    continue;
+                }
+                ShardKey key(std::stoll(dateName) * 100 + std::stoll(hourName), category);
+                shards_[key].sealed = false;
+            }
+        }
+        // 旧版平铺的文件
+        shards_[ShardKey(0, category)].sealed = false;
+    }
+
+    for (auto& item : shards_) {
+        measure(item.first, item.second);
+        item.second.sealed = item.first.first < sealedBefore;
+    }
+}
+
+void StorageManager::measure(const ShardKey& key, Shard& shard) {
+    uint64_t bytes = 0;
+    uint64_t files = 0;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(shardDir(key), ec)) {
+        std::error_code fileEc;
+        if (!entry.is_regular_file(fileEc)) {
+            continue;
+        }
+        uintmax_t size = entry.file_size(fileEc);
+        if (!fileEc) {
+            bytes += size;
+            files++;
+        }
+    }
+    shard.bytes = bytes;
+    shard.files = files;
+}
+
+void StorageManager::evict(int64_t now) {
+    const int64_t currentKey = hourKey(now);
+    const int days = retentionDays_;
+    const int64_t expiredBefore = days > 0 ? hourKey(now - days * kDayMs) : 0;
+    const uint64_t quota = quotaBytes_;
+    uint64_t used = usedBytes_;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t evictedBytes = 0;
+    int64_t evictedShards = 0;
+    for (auto it = shards_.begin(); it != shards_.end();) {
+        // 正在写入的小时永远保留
+        if (it->first.first >= currentKey) {
+            break;
+        }
+        bool legacy = it->first.first == 0;
+        bool expired = !legacy && it->first.first < expiredBefore;
+        bool overQuota = quota > 0 && used > quota;
+        if (!expired && !overQuota) {
+            if (legacy) {
+                ++it;
+                continue;
+            }
+            break;
+        }
+        removeShard(it->first);
+        used -= std::min(used, it->second.bytes);
+        evictedBytes += it->second.bytes;
+        evictedShards++;
+        it = shards_.erase(it);
+    }
+    usedBytes_ = used;
+
+    if (evictedShards > 0) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::instance().observe("storage.evict_ms", elapsed.count());
+        Metrics::instance().add("storage.evicted_bytes", static_cast<int64_t>(evictedBytes));
+        Metrics::instance().add("storage.evicted_shards", evictedShards);
+    }
+}
+
+void StorageManager::removeShard(const ShardKey& key) {
+    std::error_code ec;
+    fs::path dir = shardDir(key);
+    if (key.first == 0) {
+        // 类别目录下只删除文件, 保留分片子目录
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::error_code fileEc;
+            if (entry.is_regular_file(fileEc)) {
+                fs::remove(entry.path(), fileEc);
+            }
+        }
+        return;
+    }
+    fs::remove_all(dir, ec);
+    if (ec) {
+        std::cerr << "Failed to remove " << dir << ": " << ec.message() << std::endl;
+        return;
+    }
+    // 日期目录下的小时都删完后一并删除, 非空时 remove 会失败并保留
+    fs::remove(dir.parent_path(), ec);
+}
+
+void StorageManager::pruneDatabase(int64_t now) {
+    if (!db_ || dbRetentionDays_ <= 0 || now - lastPruneMs_ < kPruneIntervalMs) {
+        return;
+    }
+    lastPruneMs_ = now;
+    int64_t rollupBeforeMs = rollupRetentionDays_ > 0 ? now - rollupRetentionDays_ * kDayMs : 0;
+    db_->prune(now - dbRetentionDays_ * kDayMs, rollupBeforeMs);
+}
+
+void StorageManager::run() {
+    lowerThreadPriority();
+
+    auto start = std::chrono::steady_clock::now();
+    scanAll();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    Metrics::instance().observe("storage.scan_ms", elapsed.count());
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (quit_) {
+                break;
+            }
+            for (const auto& key : newShards_) {
+                shards_[key];
+            }
+            newShards_.clear();
+        }
+
+        // 只重新统计还在写入的分片
+        start = std::chrono::steady_clock::now();
+        const int64_t now = nowMs();
+        const int64_t sealedBefore = hourKey(now - kSealDelayMs);
+        uint64_t used = 0;
+        for (auto& item : shards_) {
+            if (!item.second.sealed) {
+                measure(item.first, item.second);
+                item.second.sealed = item.first.first < sealedBefore;
+            }
+            used += item.second.bytes;
+        }
+        usedBytes_ = used;
+        elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::instance().observe("storage.scan_ms", elapsed.count());
+
+        evict(now);
+        pruneDatabase(now);
+
+        uint64_t files = 0;
+        for (const auto& item : shards_) {
+            files += item.second.files;
+        }
+        Metrics::instance().set("storage.used_bytes", static_cast<double>(usedBytes_));
+        Metrics::instance().set("storage.files", static_cast<double>(files));
+        Metrics::instance().set("storage.shards", static_cast<double>(shards_.size()));
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait_for(lock, std::chrono::milliseconds(scanIntervalMs_), [this] { return quit_; });
+    }
+}
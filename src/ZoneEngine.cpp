@@ -0,0 +1,77 @@
+#include "ZoneEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+ZoneEngine::ZoneEngine(int cellSize) : cellSize_(std::max(1, cellSize)), gridW_(0), gridH_(0) {}
+
+void ZoneEngine::build(const std::vector<Zone>& zones) {
+    zones_ = zones;
+    integrals_.clear();
+
+    // 网格覆盖所有区域的外接范围即可, 范围外的框一定不在任何区域内
+    int maxX = 0, maxY = 0;
+    for (const auto& zone : zones_) {
+        for (const auto& pt : zone.polygon) {
+            maxX = std::max(maxX, pt.x);
+            maxY = std::max(maxY, pt.y);
+        }
+    }
+    gridW_ = maxX / cellSize_ + 1;
+    gridH_ = maxY / cellSize_ + 1;
+
+    for (const auto& zone : zones_) {
+        cv::Mat mask = cv::Mat::zeros(gridH_, gridW_, CV_8UC1);
+        if (zone.polygon.size() >= 3) {
+            std::vector<cv::Point> cells;
+            cells.reserve(zone.polygon.size());
+            for (const auto& pt : zone.polygon) {
+                cells.emplace_back(pt.x / cellSize_, pt.y / cellSize_);
+            }
+            // 填充内部, 再描边保证边界经过的网格也计入区域
+            cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{cells}, cv::Scalar(1));
+            cv::polylines(mask, cells, true, cv::Scalar(1), 1, cv::LINE_8);
+        }
+        cv::Mat integral;
+        cv::integral(mask, integral, CV_32S);
+        integrals_.push_back(integral);
+    }
+}
+
+bool ZoneEngine::toCells(const cv::Rect_<float>& box, int& x0, int& y0, int& x1, int& y1) const {
+    if (box.width <= 0 || box.height <= 0) {
+        return false;
+    }
+    x0 = std::max(0, static_cast<int>(std::floor(box.x)) / cellSize_);
+    y0 = std::max(0, static_cast<int>(std::floor(box.y)) / cellSize_);
+    int right = static_cast<int>(std::ceil(box.x + box.width)) - 1;
+    int bottom = static_cast<int>(std::ceil(box.y + box.height)) - 1;
+    if (right < 0 || bottom < 0) {
+        return false;
+    }
+    x1 = std::min(gridW_ - 1, right / cellSize_);
+    y1 = std::min(gridH_ - 1, bottom / cellSize_);
+    return x0 <= x1 && y0 <= y1;
+}
+
+bool ZoneEngine::overlaps(size_t zoneIdx, const cv::Rect_<float>& box) const {
+    int x0, y0, x1, y1;
+    if (zoneIdx >= integrals_.size() || !toCells(box, x0, y0, x1, y1)) {
+        return false;
+    }
+    const cv::Mat& sum = integrals_[zoneIdx];
+    int area = sum.at<int>(y1 + 1, x1 + 1) - sum.at<int>(y0, x1 + 1)
+             - sum.at<int>(y1 + 1, x0) + sum.at<int>(y0, x0);
+    return area > 0;
+}
+
+void ZoneEngine::count(const std::vector<cv::Rect_<float>>& boxes, std::vector<int>& counts) const {
+    counts.assign(zones_.size(), 0);
+    for (const auto& box : boxes) {
+        for (size_t z = 0; z < zones_.size(); ++z) {
+            if (overlaps(z, box)) {
+                counts[z]++;
+            }
+        }
+    }
+}
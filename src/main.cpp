@@ -3,6 +3,21 @@
 #include <variant>
 #include <limits>
 #include "MutexQueue.h"
+#include "ZoneEngine.h"
+#include "HeatmapService.h"
+#include "LineCounter.h"
+#include "DwellTracker.h"
+#include "Metrics.h"
+#include "ImageWriter.h"
+#include "ResultSerializer.h"
+#include "ChangeDetector.h"
+#include "DetectionLog.h"
+#include "ClipRecorder.h"
+#include "ResultBus.h"
+#include "OverlayRenderer.h"
+#include "StorageManager.h"
+#include "AppConfig.h"
+#include "ReplayBench.h"
 #include <opencv2/opencv.hpp> // 使用 OpenCV 处理图像
 
 ImageDataQueue g_imageData(QUEUE_LENGTH);
@@ -15,24 +30,54 @@ std::atomic<bool> perattr_flags{false};
 std::condition_variable resultReadyCond;
 std::mutex resultMutex;
 
-// 定义多边形框的顶点
-std::vector<cv::Point> polygon = {
-    cv::Point(350, 50),
-    cv::Point(500, 80),
-    cv::Point(550, 250),
-    cv::Point(400, 300)
-};
+// 运行配置, 通过 --config 加载; 模型、阈值、队列长度、采样间隔和区域都来自这里
+AppConfig appConfig;
+StreamConfig streamConfig;     // 当前视频源使用的流配置
 
-int threadNum = 1;
-std::atomic<uint64_t> frameID{0}; // 帧ID
+// 区域计数使用的多边形区域 (第一个区域的计数同时输出为 RegionCoun), 区域定义来自流配置
+ZoneEngine zoneEngine;
 
-std::string getCurrentTimeStr() {
-    std::time_t t = std::time(nullptr);
-    std::tm* now = std::localtime(&t);
-    char buffer[80];
-    std::strftime(buffer, 80, "%Y%m%d%H%M%S", now);
-    return std::string(buffer);
-}
+// 越线计数使用的有向线段, 来自流配置
+LineCounter lineCounter;
+
+// 区域停留统计, 停留超过 60 秒 (流配置 loiterMs) 产生徘徊事件, 只有徘徊事件写入数据库
+DwellTracker dwellTracker(1024, 60000);
+
+// 状态变化判定, 只有状态变化或关键帧 (默认 60 秒) 才写图片、结果文件和数据库
+ChangeDetector changeDetector(60000);
+
+// 全局唯一的数据库写入器, 写入在后台线程中批量提交
+std::unique_ptr<DatabaseManager> dbManager;
+
+// 二进制检测日志, 与数据库使用相同的写入点, 供回放和快速查询
+std::unique_ptr<DetectionLogWriter> detectionLog;
+
+// 事件视频片段, 通过 --clips 开启, 跌倒/火焰/烟雾出现时保存事件前后各 5 秒
+ClipRecorder clipRecorder;
+
+// 结果总线: 每帧汇总结果推送给订阅者, 通过 --bus-socket 开启 Unix 域套接字推送
+ResultBus resultBus;
+std::unique_ptr<ResultBusSocketServer> busServer;
+
+// 输出文件按日期/小时分片, 后台按保留天数和磁盘配额清理旧文件和数据库记录
+StorageManager storageManager("output");
+
+// 结果图像异步编码写盘, 默认 JPEG, 同一类别积压时只保留最新一张
+std::unique_ptr<ImageWriter> imageWriter;
+
+// 无图像输出模式, 通过 --headless 开启, 只输出结构化结果, 不绘制也不保存结果图片
+bool headlessMode = false;
+
+// 占用热力图, 通过 --heatmap 开启, 收到 SIGUSR1 时输出一张快照
+HeatmapService heatmapService;
+std::atomic<bool> heatmapSnapshotRequested{false};
+
+// 重新加载请求, 收到 SIGHUP 时设置, 由重新加载线程处理
+std::atomic<bool> reloadRequested{false};
+
+uint64_t maxFrameID = MAX_FRAME_ID;                  // 帧ID上限, 随队列长度配置变化
+std::chrono::steady_clock::time_point g_startTime;   // 进程启动时间, 用于统计首个结果的耗时
+std::atomic<uint64_t> frameID{0}; // 帧ID
 
 void exit_frees() {
     g_flags.cap_exit = true;
@@ -41,6 +86,20 @@ void exit_frees() {
     std::this_thread::sleep_for(std::chrono::seconds(1));
     g_imageData.clear();
     g_frameData.clear();
+    if (dbManager) {
+        dbManager->flush();
+    }
+    if (imageWriter) {
+        imageWriter->flush();
+    }
+    if (detectionLog) {
+        detectionLog->sync();
+    }
+    storageManager.stop();
+    clipRecorder.stop();
+    if (busServer) {
+        busServer->stop();
+    }
     std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
@@ -50,20 +109,20 @@ void signalHandler(int signum) {
     exit(signum); 
 }
 
+void heatmapSignalHandler(int signum) {
+    heatmapSnapshotRequested = true;
+}
+
+void reloadSignalHandler(int signum) {
+    reloadRequested = true;
+}
+
 // 判断点是否在多边形框内
 bool isPointInPolygon(const std::vector<cv::Point>& polygon, const cv::Point& point) {
     double result = cv::pointPolygonTest(polygon, point, false);
     return result >= 0;
 }
 
-// 绘制多边形框的函数
-void drawPolygon(cv::Mat& image, const std::vector<cv::Point>& polygon) {
-    // 绘制多边形
-    const cv::Point* points[1] = { polygon.data() };
-    int numberOfPoints[] = { static_cast<int>(polygon.size()) };
-    cv::polylines(image, points, numberOfPoints, 1, true, cv::Scalar(0, 255, 0), 2, cv::LINE_AA);
-}
-
 std::string extract_ip(const std::string& rtsp_url) {
     std::regex ip_regex(R"((\d{1,3}\.){3}\d{1,3})"); // 匹配IPv4地址的正则表达式
     std::smatch match;
@@ -100,22 +159,75 @@ void insertRTSPLog(sqlite3* db, const std::string& timestamp, const std::string&
     sqlite3_finalize(stmt);
 }
 
+// 视频结束后等待在途帧处理完再写出基准测试报告; 丢帧后在途计数不会归零, 以队列清空或 10 秒无进展为准
+void finishBench() {
+    ReplayBench& bench = ReplayBench::instance();
+    uint64_t inFlight = bench.inFlight();
+    auto lastProgress = std::chrono::steady_clock::now();
+    while (inFlight > 0 && !(g_imageData.empty() && g_frameData.empty()) &&
+           std::chrono::steady_clock::now() - lastProgress < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (bench.inFlight() != inFlight) {
+            inFlight = bench.inFlight();
+            lastProgress = std::chrono::steady_clock::now();
+        }
+    }
+    bench.addDrops("queue.image", g_imageData.dropped());
+    bench.addDrops("queue.frame", g_frameData.dropped());
+    // 输出阶段是异步的, 等待图片和数据库写完再取指标
+    if (imageWriter) {
+        imageWriter->flush();
+    }
+    if (dbManager) {
+        dbManager->flush();
+    }
+    bench.writeReport(Metrics::instance().toJson());
+}
+
 void captureFrames(ExitFlags& flags, const std::string& frameSrc) {
     // cv::VideoCapture capture("rtsp://192.168.202.217:554/stream1");
     // cv::VideoCapture capture("/dev/video1");
     cv::VideoCapture capture(frameSrc);
     cv::Mat inputImage;
+    // 热力图网格按视频尺寸预先分配, 不在第一帧时分配; 读不到尺寸时使用配置中的尺寸
+    if (heatmapService.running()) {
+        cv::Size frameSize(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                           static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        if (frameSize.area() <= 0) {
+            frameSize = streamConfig.frameSize;
+        }
+        if (frameSize.area() > 0) {
+            heatmapService.prepare(frameSize);
+        }
+    }
+    // 每隔 sampleIntervalMs 送一帧进入推理
+    const double sampleInterval = streamConfig.sampleIntervalMs / 1000.0;
     std::filesystem::create_directories("output/src");
     // 初始化帧数和时间
     uint64_t frameCount = 0;
     double fps = 0.0;
     auto lastTime = std::chrono::high_resolution_clock::now();  // 记录开始时间
 
+    // 基准测试时每个解码帧都送入推理: 限速时按固定间隔送帧, 队列溢出计为丢帧;
+    // 不限速时最多 8 帧在途 (不超过队列长度), 各阶段保持忙碌而排队时间不随队列长度增长
+    ReplayBench& bench = ReplayBench::instance();
+    const uint64_t benchWindow = std::min<uint64_t>(8, std::max<size_t>(appConfig.queueLength, 2) - 1);
+    const auto benchInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(bench.rate() > 0 ? 1.0 / bench.rate() : 0.0));
+    auto nextBenchFrame = std::chrono::steady_clock::now();
+    double captureCpuMs = ReplayBench::threadCpuMs();
+    // 采集序号不随帧ID循环, 检测日志按它索引
+    uint64_t captureSequence = 0;
+
     while (!flags.cap_exit) {
         auto currentFrameTime = std::chrono::high_resolution_clock::now();  // 每帧的时间
 
+        auto readStart = std::chrono::steady_clock::now();
         if (!(capture.isOpened() && capture.read(inputImage))) {
             std::cout << "capture exit\n" << std::flush;
+            if (bench.enabled()) {
+                finishBench();
+            }
             exit_frees();
             exit(0);
         }
@@ -130,6 +242,9 @@ void captureFrames(ExitFlags& flags, const std::string& frameSrc) {
         std::ostringstream oss;
         oss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S");
         std::string timestamp = oss.str();
+        int64_t timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        clipRecorder.pushFrame(inputImage, timestampMs);
 
         // 将数据插入数据库
         // insertRTSPLog(db, timestamp, extract_ip(), frameSrc);
@@ -141,13 +256,26 @@ void captureFrames(ExitFlags& flags, const std::string& frameSrc) {
         // 每帧递增帧数
         frameCount++;
 
-        // 如果超过1秒，计算一次FPS并重置帧数
-        if (elapsedTime.count() >= 1.0) {
+        if (bench.enabled()) {
+            std::chrono::duration<double, std::milli> readMs = std::chrono::steady_clock::now() - readStart;
+            bench.observe("capture", readMs.count());
+            if (bench.rate() > 0) {
+                nextBenchFrame += benchInterval;
+                std::this_thread::sleep_until(nextBenchFrame);
+            } else {
+                while (bench.inFlight() >= benchWindow && !flags.cap_exit) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
+
+        // 如果超过采样间隔，计算一次FPS并重置帧数
+        if (bench.enabled() || elapsedTime.count() >= sampleInterval) {
             // 更新帧ID
             uint64_t currentFrameID = frameID.fetch_add(1);
 
             // 检查帧ID是否溢出
-            if (currentFrameID >= MAX_FRAME_ID) {
+            if (currentFrameID >= maxFrameID) {
                 frameID.store(0); // 重置帧ID
                 std::cout << "reset ID\n" << std::flush;
             }
@@ -158,7 +286,13 @@ void captureFrames(ExitFlags& flags, const std::string& frameSrc) {
             lastTime = currentTime;
             frameCount = 0;
             // cv::imwrite("output/src/" + timestamp + ".png", inputImage);
-            g_imageData.push(currentFrameID, inputImage, timestamp, extract_ip(frameSrc));
+            if (bench.enabled()) {
+                bench.frameCaptured(currentFrameID);
+            }
+            g_imageData.push(currentFrameID, inputImage, timestamp, extract_ip(frameSrc), timestampMs, captureSequence++);
+        }
+        if (bench.enabled()) {
+            bench.chargeCpu("capture", captureCpuMs);
         }
 
         std::cout << "." << std::flush;
@@ -170,6 +304,8 @@ void captureFrames(ExitFlags& flags, const std::string& frameSrc) {
 void inferenceThread(rknnPool<PerDet, cv::Mat, PerDetResult>& perDetPool,
                      rknnPool<FallDet, cv::Mat, FallDetResult>& fallDetPool,
                      rknnPool<FireSmokeDet, cv::Mat, FireSmokeDetResult>& fireSmokeDetPool, ExitFlags& flags) {
+    ReplayBench& bench = ReplayBench::instance();
+    double dispatchCpuMs = ReplayBench::threadCpuMs();
     while (!flags.cap_exit && !flags.infer_exit) {
         if (g_imageData.empty()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -199,28 +335,184 @@ void inferenceThread(rknnPool<PerDet, cv::Mat, PerDetResult>& perDetPool,
         });
 
         // g_frameData.push(imageData->frameID, frame);
-        g_frameData.push(imageData->frameID, frame, imageData->timestamp, extract_ip(rtsp_url));
+        g_frameData.push(imageData->frameID, frame, imageData->timestamp, extract_ip(rtsp_url), imageData->timestampMs,
+                         imageData->sequence);
         g_imageData.pop();
 
         // 等待所有线程完成
         perDetThread.join();
         fallDetThread.join();
         fireSmokeDetThread.join();
+        // 各模型的推理耗时和 CPU 时间在模型池任务中记录, 这里只统计分发本身
+        if (bench.enabled()) {
+            bench.chargeCpu("infer.dispatch", dispatchCpuMs);
+        }
         resultReadyCond.notify_all();
         std::cout << "*" << std::flush;
         // std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
 }
 
-void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDetPool, ExitFlags& flags) {
+// 将一帧的检测结果转换为定长记录, 供二进制检测日志和数据库共用
+std::vector<DetLogRecord> makeDetectionRecords(const FrameData& frameData) {
+    std::vector<DetLogRecord> records;
+    records.reserve(frameData.perDetResult.detections.size() + frameData.fallDetResult.detections.size() +
+                    frameData.fireSmokeDetResult.detections.size());
+    auto makeRecord = [&frameData](DetLogModel model, const cv::Rect_<float>& box, float confidence) {
+        DetLogRecord record{};
+        record.timestampMs = frameData.imageData.timestampMs;
+        record.sequence = frameData.imageData.sequence;
+        record.frameID = static_cast<uint32_t>(frameData.imageData.frameID);
+        record.trackId = -1;
+        record.confidence = confidence;
+        record.x = box.x;
+        record.y = box.y;
+        record.width = box.width;
+        record.height = box.height;
+        record.model = static_cast<uint8_t>(model);
+        return record;
+    };
+    for (const auto& detection : frameData.perDetResult.detections) {
+        // 跟踪输出的框不带置信度
+        DetLogRecord record = makeRecord(DetLogModel::Person, detection.box, 1.0f);
+        record.trackId = detection.id;
+        records.push_back(record);
+    }
+    for (const auto& detection : frameData.fallDetResult.detections) {
+        records.push_back(makeRecord(DetLogModel::Fall, detection.box, detection.confidence));
+    }
+    for (const auto& detection : frameData.fireSmokeDetResult.detections) {
+        DetLogRecord record = makeRecord(DetLogModel::FireSmoke, detection.box, detection.confidence);
+        record.classId = static_cast<uint8_t>(detection.id);
+        records.push_back(record);
+    }
+    return records;
+}
 
-    std::filesystem::create_directories("output/perdet");
-    std::filesystem::create_directories("output/falldet");
-    std::filesystem::create_directories("output/firesmokedet");
-    std::filesystem::create_directories("output/result");
+// 把模型配置应用到模型池, 参数按值保存, 之后创建的实例 (包括重新加载) 使用这些参数
+template <typename Model, typename Result>
+void applyModelConfig(rknnPool<Model, cv::Mat, Result>& pool, const AppConfig& config, const ModelConfig& model) {
+    float boxThreshold = model.boxThreshold;
+    float nmsThreshold = model.nmsThreshold;
+    bool pipelined = model.pipelined;
+    pool.setExpectedInputSize(model.inputSize);
+    pool.setModelSetup([boxThreshold, nmsThreshold, pipelined](Model& instance) {
+        instance.setThresholds(boxThreshold, nmsThreshold);
+        instance.setPipelined(pipelined);
+    });
+}
+
+// 人员检测另外设置跟踪参数和标签文件; 跟踪会话只在首次初始化时创建, 重新加载时保留已有轨迹
+// 标签从模型目录加载, 不依赖当前工作目录
+void applyModelConfig(rknnPool<PerDet, cv::Mat, PerDetResult>& pool, const AppConfig& config, const ModelConfig& model) {
+    const TrackerConfig& tracker = config.tracker;
+    std::string labelsPath;
+    if (!config.modelDir.empty()) {
+        labelsPath = (std::filesystem::path(config.modelDir) / "coco_80_labels_list.txt").string();
+    }
+    float boxThreshold = model.boxThreshold;
+    float nmsThreshold = model.nmsThreshold;
+    bool pipelined = model.pipelined;
+    PerDetTrackParams track;
+    track.maxAge = tracker.maxAge;
+    track.minHits = tracker.minHits;
+    track.iouThreshold = tracker.iouThreshold;
+    track.lowThreshold = tracker.lowThreshold;
+    track.lowIou = tracker.lowIou;
+    pool.setExpectedInputSize(model.inputSize);
+    pool.setModelSetup([boxThreshold, nmsThreshold, pipelined, track, labelsPath](PerDet& instance) {
+        instance.setThresholds(boxThreshold, nmsThreshold);
+        instance.setPipelined(pipelined);
+        instance.setTrackParams(track);
+        instance.setLabelsPath(labelsPath);
+    });
+}
+
+// 初始化模型池并预热, 预热耗时计入启动时间, 第一帧真实推理即为稳态耗时
+// 预热使用流配置中的视频尺寸, 同时覆盖缩放路径
+template <typename Pool>
+int initAndWarmup(Pool& pool) {
+    int ret = pool.init();
+    if (ret != 0) {
+        return ret;
+    }
+    return pool.warmup(streamConfig.frameSize);
+}
+
+// 按新配置重建模型池, 新实例预热完成后才替换, 失败时继续使用原实例
+template <typename Pool>
+int reloadPool(Pool& pool, const AppConfig& config, const ModelConfig& model) {
+    applyModelConfig(pool, config, model);
+    return pool.reload(config.modelFile(model), streamConfig.frameSize);
+}
+
+// 收到 SIGHUP 后重新读取配置文件并重建全部模型池, 采集和推理不中断
+// 模型文件、检测阈值和二次关联阈值在替换后生效; 实例数、其它跟踪参数、视频流和队列配置需要重启才生效
+// 重新加载的配置只用于新建的实例, 不写回全局配置: 其它线程在读全局配置, 命令行覆盖的参数也保持不变
+void reloadThread(rknnPool<PerDet, cv::Mat, PerDetResult>& perDetPool,
+                  rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDetPool,
+                  rknnPool<FallDet, cv::Mat, FallDetResult>& fallDetPool,
+                  rknnPool<FireSmokeDet, cv::Mat, FireSmokeDetResult>& fireSmokeDetPool, ExitFlags& flags) {
+    while (!flags.cap_exit) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (!reloadRequested.exchange(false)) {
+            continue;
+        }
+        // 从默认值开始加载, 配置文件中删除的项恢复默认值
+        AppConfig next;
+        next.modelDir = appConfig.modelDir;
+        if (!appConfig.sourcePath.empty() && next.load(appConfig.sourcePath) != 0) {
+            std::cerr << "Reload failed, keeping the current config and models" << std::endl;
+            Metrics::instance().add("model.reload_failures");
+            continue;
+        }
+        std::cout << "\nReloading models, " << next.summary() << std::endl;
+
+        // 各模型池并行重建, 单个模型池失败不影响其它模型池
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<int>> reloads;
+        reloads.push_back(std::async(std::launch::async, [&] { return reloadPool(perDetPool, next, next.perDet); }));
+        reloads.push_back(std::async(std::launch::async, [&] { return reloadPool(perAttrDetPool, next, next.perAttr); }));
+        reloads.push_back(std::async(std::launch::async, [&] { return reloadPool(fallDetPool, next, next.fallDet); }));
+        reloads.push_back(std::async(std::launch::async, [&] { return reloadPool(fireSmokeDetPool, next, next.fireSmokeDet); }));
+        int failed = 0;
+        for (auto& reload : reloads) {
+            if (reload.get() != 0) {
+                failed++;
+            }
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Reload finished in " << elapsed.count() << " ms, " << failed << " model pool(s) failed; "
+                  << "instance counts, tracker maxAge/minHits/iouThreshold, stream and queue settings apply after a restart"
+                  << std::endl;
+    }
+}
+
+// 追加一个模型池各实例的初始化耗时, query 为 init 中除加载和 rknn_init 之外的部分
+template <typename Pool>
+void appendInitReport(const Pool& pool, std::ostringstream& report, double& sequentialMs) {
+    const std::string name = std::filesystem::path(pool.modelPath()).filename().string();
+    const auto& timings = pool.initTimings();
+    for (size_t i = 0; i < timings.size(); ++i) {
+        const ModelInitTiming& t = timings[i];
+        double queryMs = std::max(0.0, t.totalMs - t.loadMs - t.initMs);
+        char line[192];
+        std::snprintf(line, sizeof(line), "  %-22s %4zu %9.1f %9.1f %9.1f %9.1f  %-6s %9.1f %9.1f\n", name.c_str(), i,
+                      t.loadMs, t.initMs, queryMs, t.totalMs, t.shared ? "yes" : "no", t.warmupFirstMs, t.warmupSteadyMs);
+        report << line;
+        sequentialMs += t.totalMs;
+    }
+}
+
+void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDetPool, ExitFlags& flags) {
 
     int count;
     std::string countText;
+    uint64_t processedFrames = 0;
+    ResultSerializer resultSerializer;
+    OverlayRenderer overlay(headlessMode);
+    ReplayBench& bench = ReplayBench::instance();
+    double aggregateCpuMs = ReplayBench::threadCpuMs();
 
     while (!flags.result_exit) {
         if (g_frameData.empty()) {
@@ -240,77 +532,138 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
         if (!frameData) {
             continue;
         }
-        cv::Mat origImage = frameData->imageData.frame.clone();
-        if (origImage.empty()) {
+        // 原图只读, 叠加内容在需要输出图片时才绘制到副本上
+        const cv::Mat& frameImage = frameData->imageData.frame;
+        if (frameImage.empty()) {
             continue;
         }
-        cv::Mat displayImage = origImage.clone();
-        // 获取当前时间字符串用于文件命名
-        std::string timeStr = getCurrentTimeStr();
-
-        // 初始化 JSON 对象
+        if (bench.enabled()) {
+            bench.resultStarted(frameData->imageData.frameID);
+            // 等待超时, 部分模型的结果没有参与汇总
+            if (!(frameData->perDetResult.ready_ && frameData->fallDetResult.ready_ && frameData->fireSmokeDetResult.ready_)) {
+                bench.addDrops("result.incomplete", 1);
+            }
+        }
+        overlay.begin(frameImage);
+        // 初始化 JSON 对象, 每个子树只序列化一次
         Json::Value root;
+        resultSerializer.reset();
         root["frameID"] = static_cast<Json::UInt64>(frameData->imageData.frameID);
+        int64_t frameTimeMs = frameData->imageData.timestampMs;
+        const uint64_t currentFrameID = frameData->imageData.frameID;
+        root["timestampMs"] = static_cast<Json::Int64>(frameTimeMs);
+        std::vector<LoiterEvent> loiterEvents;
+
+        // 区域计数与停留统计, 同时作为状态变化判定的输入
+        std::vector<int> zoneCounts(zoneEngine.size(), 0);
+        changeDetector.beginFrame();
+        if (frameData->perDetResult.ready_) {
+            std::vector<int> trackIds;
+            trackIds.reserve(frameData->perDetResult.detections.size());
+            for (const auto& detection : frameData->perDetResult.detections) {
+                trackIds.push_back(detection.id);
+                // 判断是否与各区域有重叠, 有重叠则计数
+                for (size_t z = 0; z < zoneEngine.size(); ++z) {
+                    if (zoneEngine.overlaps(z, detection.box)) {
+                        zoneCounts[z]++;
+                        dwellTracker.update(detection.id, z, frameTimeMs, loiterEvents);
+                    }
+                }
+            }
+            changeDetector.updateTracks(trackIds);
+            changeDetector.updateZones(zoneCounts);
+        }
+        if (frameData->fallDetResult.ready_) {
+            changeDetector.updateHazard(ChangeDetector::Fall, !frameData->fallDetResult.detections.empty());
+        }
+        if (frameData->fireSmokeDetResult.ready_) {
+            bool fire = false;
+            bool smoke = false;
+            for (const auto& detection : frameData->fireSmokeDetResult.detections) {
+                fire |= detection.id == 0;
+                smoke |= detection.id == 1;
+            }
+            changeDetector.updateHazard(ChangeDetector::Fire, fire);
+            changeDetector.updateHazard(ChangeDetector::Smoke, smoke);
+        }
+        uint32_t changes = changeDetector.endFrame(frameTimeMs);
+        bool persist = changes != 0;
+        if (changes & ChangeDetector::FallOnset) {
+            clipRecorder.trigger("fall", frameTimeMs);
+        }
+        if (changes & ChangeDetector::FireOnset) {
+            clipRecorder.trigger("fire", frameTimeMs);
+        }
+        if (changes & ChangeDetector::SmokeOnset) {
+            clipRecorder.trigger("smoke", frameTimeMs);
+        }
+        Metrics::instance().add(persist ? "persist.frames" : "persist.skipped");
+        if (persist) {
+            std::vector<const char*> changeNames;
+            ChangeDetector::names(changes, changeNames);
+            for (const char* name : changeNames) {
+                root["changes"].append(name);
+            }
+        }
 
         // 处理人检测结果
         if (frameData->perDetResult.ready_) {
+            // 热力图只入队跟踪框, 累加在服务线程中完成
+            if (heatmapService.running()) {
+                std::vector<cv::Rect_<float>> boxes;
+                boxes.reserve(frameData->perDetResult.detections.size());
+                for (const auto& detection : frameData->perDetResult.detections) {
+                    boxes.push_back(detection.box);
+                }
+                heatmapService.submit(frameImage.size(), boxes);
+            }
+
+            // 越线计数, 每条轨迹只与上一帧中心点比较
+            std::vector<LineCrossing> crossings;
+            lineCounter.beginFrame();
+            for (const auto& detection : frameData->perDetResult.detections) {
+                lineCounter.update(detection.id, detection.box, crossings);
+            }
+            lineCounter.endFrame();
+            for (const auto& crossing : crossings) {
+                const CountLine& line = lineCounter.lines()[crossing.lineIdx];
+                Metrics::instance().add("line." + line.name + (crossing.forward ? ".forward" : ".backward"));
+            }
+            Metrics::instance().set("line.tracks", lineCounter.trackCount());
+            for (size_t i = 0; i < lineCounter.lines().size(); ++i) {
+                Json::Value lineJson;
+                lineJson["forward"] = static_cast<Json::UInt64>(lineCounter.counts()[i].forward);
+                lineJson["backward"] = static_cast<Json::UInt64>(lineCounter.counts()[i].backward);
+                root["lineCrossings"][lineCounter.lines()[i].name] = lineJson;
+            }
             if (!frameData->perDetResult.detections.empty()) {
                 Json::Value perDetJson;
-                cv::Mat perDetImage = displayImage.clone();
-                count = 0;
                 std::vector<std::thread> perAttrThreads; // 存储线程
                 for (const auto& detection : frameData->perDetResult.detections) {
-                    // 将检测框转换为多边形
                     cv::Rect detectionRect(detection.box.x, detection.box.y, detection.box.width, detection.box.height);
-                    std::vector<cv::Point> detectionPolygon = {
-                        cv::Point(detectionRect.tl().x, detectionRect.tl().y),  // 左上角
-                        cv::Point(detectionRect.br().x, detectionRect.tl().y),  // 右上角
-                        cv::Point(detectionRect.br().x, detectionRect.br().y),  // 右下角
-                        cv::Point(detectionRect.tl().x, detectionRect.br().y)   // 左下角
-                    };
                     cv::Rect box(static_cast<int>(detectionRect.tl().x), static_cast<int>(detectionRect.tl().y),
                                 static_cast<int>(detection.box.width), static_cast<int>(detection.box.height));
                     // 判断框是否在原始图像内
                     if (detectionRect.x >= 0 && detectionRect.y >= 0 &&
-                        detectionRect.x + detectionRect.width <= perDetImage.cols &&
-                        detectionRect.y + detectionRect.height <= perDetImage.rows) {
+                        detectionRect.x + detectionRect.width <= frameImage.cols &&
+                        detectionRect.y + detectionRect.height <= frameImage.rows) {
 
                         // 确保框在图像内才执行 perAttr 线程
-                        cv::Mat image = displayImage(detectionRect).clone();
+                        cv::Mat image = frameImage(detectionRect).clone();
                         std::thread perAttrDetThread([&perAttrDetPool, image, frameID = frameData->imageData.frameID, ID = detection.id]() {
                             perAttrDetPool.put(image, frameID, ID);
                         });
 
                         perAttrThreads.push_back(std::move(perAttrDetThread)); // 添加线程
+                        Metrics::instance().add("perattr.calls");
                     }
-                    // cv::Mat image = displayImage(box).clone();
+                    // cv::Mat image = frameImage(box).clone();
                     // std::thread perAttrDetThread([&perAttrDetPool, image, frameID = frameData->imageData.frameID, ID = detection.id]() {
                     //     perAttrDetPool.put(image, frameID, ID);
                     // });
-                    cv::Scalar color((detection.id * 123) % 256, (detection.id * 456) % 256, (detection.id * 789) % 256);
-
-                    // 绘制矩形框和文本
-                    std::string text = std::to_string(detection.id);
-                    int baseline = 0;
-                    cv::Size textSize = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
-                    cv::Point textOrigin(detection.box.x, detection.box.y);
-                    cv::Rect textRect(textOrigin, textSize);
-                    cv::rectangle(perDetImage, textRect, color, cv::FILLED);
-                    putText(perDetImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(perDetImage, detection.box, color, 1);
-
-                    cv::rectangle(origImage, textRect, color, cv::FILLED);
-                    putText(origImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(origImage, detection.box, color, 1);
-
-                    // 判断是否与多边形有重叠
-                    std::vector<cv::Point> intersectionPolygon;
-                    double intersectionArea = cv::intersectConvexConvex(detectionPolygon, polygon, intersectionPolygon);
-
-                    // 如果有重叠则计数
-                    if (intersectionArea > 0) {
-                        count++;
-                    }
+                    // 登记矩形框和文本
+                    overlay.addBox(LayerPerson, detection.box, std::to_string(detection.id), detection.id);
+
                     // 存储 JSON 数据
                     Json::Value det;
                     det["id"] = detection.id;
@@ -320,21 +673,31 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
                     det["height"] = detection.box.height;
                     perDetJson.append(det);
                 }
+                count = zoneCounts.empty() ? 0 : zoneCounts[0];
+                Json::Value zoneJson;
+                for (size_t z = 0; z < zoneEngine.size(); ++z) {
+                    zoneJson[zoneEngine.zones()[z].name] = zoneCounts[z];
+                }
                 root["personDetections"] = perDetJson;
                 root["RegionCoun"] = count;
+                root["zoneCounts"] = zoneJson;
 
-                // 保存原始人检测结果图像
-                drawPolygon(perDetImage, polygon);
-                drawPolygon(origImage, polygon);
+                for (const auto& zone : zoneEngine.zones()) {
+                    overlay.addPolygon(LayerZones, &zone.polygon);
+                }
                 // 在左上角显示 count 变量值
                 countText = "Count: " + std::to_string(count);
-                cv::putText(perDetImage, countText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-
-                cv::imwrite("output/perdet/" + timeStr + ".png", perDetImage);
-                std::ofstream perdetFile("output/perdet/" + timeStr + ".json");
-                perdetFile << root["personDetections"].toStyledString();  // 写入 JSON 数据
-                // std::cout << root["personDetections"].toStyledString() << std::flush;
-                perdetFile.close();
+                overlay.addText(LayerZones, countText, cv::Point(10, 30), 1.0, 2);
+
+                // 保存人检测结果图像
+                if (persist) {
+                    std::string perdetPath = storageManager.pathFor("perdet", frameTimeMs, currentFrameID);
+                    imageWriter->write("perdet", perdetPath, overlay.render(LayerPerson | LayerZones));
+                    std::ofstream perdetFile(perdetPath + ".json");
+                    perdetFile << resultSerializer.add("personDetections", root["personDetections"]);  // 写入 JSON 数据
+                    // std::cout << root["personDetections"].toStyledString() << std::flush;
+                    perdetFile.close();
+                }
                 for (auto& t : perAttrThreads) {
                     if (t.joinable()) {
                         t.join(); // 等待每个线程完成
@@ -342,7 +705,7 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
                 }
             }
             std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            if (frameData->perDetResult.ready_ && !frameData->perAttrResult.detections.empty()) {
+            if (persist && frameData->perDetResult.ready_ && !frameData->perAttrResult.detections.empty()) {
                 Json::Value perAttrJson;
                 for (const auto& detection : frameData->perAttrResult.detections) {
                     Json::Value attr;
@@ -357,34 +720,44 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
                 }
                 root["perAttrDetections"] = perAttrJson;
                 // cv::imwrite("output/perdet/" + timeStr + ".png", perDetImage);
-                std::ofstream perdetFile("output/perdet/" + timeStr + ".json");
-                perdetFile << root["perAttrDetections"].toStyledString();  // 写入 JSON 数据
+                std::ofstream perdetFile(storageManager.pathFor("perdet", frameTimeMs, currentFrameID) + ".json");
+                perdetFile << resultSerializer.add("perAttrDetections", root["perAttrDetections"]);  // 写入 JSON 数据
                 // std::cout << root["perAttrDetections"].toStyledString() << std::flush;
                 perdetFile.close();
             }
         }
 
+        // 徘徊事件: 只在事件发生时写入数据库, 不再逐帧记录停留状态
+        if (frameData->perDetResult.ready_) {
+            dwellTracker.endFrame(frameTimeMs, loiterEvents);
+            Metrics::instance().set("dwell.entries", dwellTracker.size());
+        }
+        if (!loiterEvents.empty()) {
+            Json::Value loiterJson;
+            for (const auto& event : loiterEvents) {
+                const std::string& zoneName = zoneEngine.zones()[event.zoneIdx].name;
+                const char* kind = event.kind == LoiterEvent::Start ? "start" : "end";
+                dbManager->insertLoiterEvent(frameData->imageData.ip, event.trackId, zoneName, kind,
+                                            event.enterMs, event.eventMs, event.dwellMs);
+                Metrics::instance().add(std::string("loiter.") + kind);
+
+                Json::Value item;
+                item["id"] = event.trackId;
+                item["zone"] = zoneName;
+                item["kind"] = kind;
+                item["dwellMs"] = static_cast<Json::Int64>(event.dwellMs);
+                loiterJson.append(item);
+            }
+            root["loiterEvents"] = loiterJson;
+        }
+
         // 处理跌倒检测结果
         if (frameData->fallDetResult.ready_) {
             if (!frameData->fallDetResult.detections.empty()) {
                 Json::Value fallDetJson;
-                cv::Mat fallDetImage = displayImage.clone();
                 for (const auto& detection : frameData->fallDetResult.detections) {
-                    cv::Scalar color((detection.id * 123) % 256, (detection.id * 456) % 256, (detection.id * 789) % 256);
-
-                    // 绘制矩形框和文本
-                    std::string text = std::to_string(detection.id);
-                    int baseline = 0;
-                    cv::Size textSize = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
-                    cv::Point textOrigin(detection.box.x, detection.box.y);
-                    cv::Rect textRect(textOrigin, textSize);
-                    cv::rectangle(fallDetImage, textRect, color, cv::FILLED);
-                    putText(fallDetImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(fallDetImage, detection.box, color, 1);
-
-                    cv::rectangle(origImage, textRect, color, cv::FILLED);
-                    putText(origImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(origImage, detection.box, color, 1);
+                    // 登记矩形框和文本
+                    overlay.addBox(LayerFall, detection.box, std::to_string(detection.id), detection.id);
 
                     // 存储 JSON 数据
                     Json::Value det;
@@ -398,11 +771,14 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
                 root["fallDetections"] = fallDetJson;
 
                 // 保存原始跌倒检测结果图像
-                cv::imwrite("output/falldet/" + timeStr + ".png", fallDetImage);
-                std::ofstream falldetFile("output/falldet/" + timeStr + ".json");
-                falldetFile << root["fallDetections"].toStyledString();  // 写入 JSON 数据
-                // std::cout << root["fallDetections"].toStyledString() << std::flush;
-                falldetFile.close();
+                if (persist) {
+                    std::string falldetPath = storageManager.pathFor("falldet", frameTimeMs, currentFrameID);
+                    imageWriter->write("falldet", falldetPath, overlay.render(LayerFall));
+                    std::ofstream falldetFile(falldetPath + ".json");
+                    falldetFile << resultSerializer.add("fallDetections", root["fallDetections"]);  // 写入 JSON 数据
+                    // std::cout << root["fallDetections"].toStyledString() << std::flush;
+                    falldetFile.close();
+                }
             }
         }
 
@@ -410,29 +786,15 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
         if (frameData->fireSmokeDetResult.ready_) {
             if (!frameData->fireSmokeDetResult.detections.empty()) {
                 Json::Value fireSmokeJson;
-                cv::Mat fireSmokeDetImage = displayImage.clone();
                 for (const auto& detection : frameData->fireSmokeDetResult.detections) {
-                    cv::Scalar color((detection.id * 123) % 256, (detection.id * 456) % 256, (detection.id * 789) % 256);
-
-                    // 绘制矩形框和文本
+                    // 登记矩形框和文本
                     std::string text;
-                    int baseline = 0;
                     if (detection.id == 0) {
                         text = "fire";
                     } else if (detection.id == 1) {
                         text = "smoke";
                     }
-
-                    cv::Size textSize = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
-                    cv::Point textOrigin(detection.box.x, detection.box.y);
-                    cv::Rect textRect(textOrigin, textSize);
-                    cv::rectangle(fireSmokeDetImage, textRect, color, cv::FILLED);
-                    putText(fireSmokeDetImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(fireSmokeDetImage, detection.box, color, 1);
-
-                    cv::rectangle(origImage, textRect, color, cv::FILLED);
-                    putText(origImage, text, textOrigin + cv::Point(0, textSize.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255));
-                    cv::rectangle(origImage, detection.box, color, 1);
+                    overlay.addBox(LayerFireSmoke, detection.box, text, detection.id);
 
                     // 存储 JSON 数据
                     Json::Value det;
@@ -446,30 +808,67 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
                 root["fireSmokeDetections"] = fireSmokeJson;
 
                 // 保存原始火焰烟雾检测结果图像
-                cv::imwrite("output/firesmokedet/" + timeStr + ".png", fireSmokeDetImage);
-                std::ofstream firesmokeFile("output/firesmokedet/" + timeStr + ".json");
-                firesmokeFile << root["fireSmokeDetections"].toStyledString();  // 写入 JSON 数据
-                // std::cout << root["fireSmokeDetections"].toStyledString() << std::flush;
-                firesmokeFile.close();
+                if (persist) {
+                    std::string firesmokePath = storageManager.pathFor("firesmokedet", frameTimeMs, currentFrameID);
+                    imageWriter->write("firesmokedet", firesmokePath, overlay.render(LayerFireSmoke));
+                    std::ofstream firesmokeFile(firesmokePath + ".json");
+                    firesmokeFile << resultSerializer.add("fireSmokeDetections", root["fireSmokeDetections"]);  // 写入 JSON 数据
+                    // std::cout << root["fireSmokeDetections"].toStyledString() << std::flush;
+                    firesmokeFile.close();
+                }
+            }
+        }
+        // 变化到空状态 (目标丢失、跌倒/火焰/烟雾消失、区域计数归零) 同样需要记录
+        if (persist) {
+            // 保存合成的结果图像, 所有图层一次绘制
+            std::string resultPath = storageManager.pathFor("result", frameTimeMs, currentFrameID);
+            imageWriter->write("result", resultPath, overlay.render(LayerAll));
+            std::ofstream resultFile(resultPath + ".json");
+            std::shared_ptr<const std::string> resultStr = resultSerializer.finish(root);
+            resultFile << *resultStr;
+            dbManager->insertLog(frameData->imageData.timestamp, frameData->imageData.ip, rtsp_url, resultStr);
+            std::vector<DetLogRecord> detRecords = makeDetectionRecords(*frameData);
+            detectionLog->append(detRecords);
+            std::vector<std::pair<std::string, int>> zoneRows;
+            if (frameData->perDetResult.ready_) {
+                for (size_t z = 0; z < zoneEngine.size(); ++z) {
+                    zoneRows.emplace_back(zoneEngine.zones()[z].name, zoneCounts[z]);
+                }
             }
+            dbManager->insertFrame(frameData->imageData.ip, rtsp_url, frameData->imageData.timestampMs,
+                                   frameData->imageData.frameID, std::move(detRecords), std::move(zoneRows));
         }
-        if ((g_frameData.front()->perDetResult.ready_ ||
-                g_frameData.front()->fallDetResult.ready_ ||
-                g_frameData.front()->fireSmokeDetResult.ready_) && ( 
-                !frameData->perDetResult.detections.empty() ||
-                !frameData->fallDetResult.detections.empty() ||
-                !frameData->fireSmokeDetResult.detections.empty())) {
-            // 保存合成的结果图像
-            cv::putText(origImage, countText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 2);
-            cv::imwrite("output/result/" + timeStr + ".png", origImage);
-            std::ofstream resultFile("output/result/" + timeStr + ".json");
-            resultFile << root.toStyledString();
-            DatabaseManager dbManager("data.db");
-            dbManager.insertLog(frameData->imageData.timestamp, frameData->imageData.ip, rtsp_url, root.toStyledString());
+        if (heatmapSnapshotRequested.exchange(false) && heatmapService.running()) {
+            cv::Mat heatmapImage = heatmapService.snapshot(frameImage);
+            if (!heatmapImage.empty()) {
+                imageWriter->write("heatmap", storageManager.pathFor("heatmap", frameTimeMs, currentFrameID), heatmapImage);
+            }
+        }
+        if (processedFrames == 0) {
+            std::chrono::duration<double, std::milli> firstResult = std::chrono::steady_clock::now() - g_startTime;
+            std::cout << "\nFirst result after " << firstResult.count() << " ms" << std::endl;
+            Metrics::instance().set("startup.first_result_ms", firstResult.count());
+        }
+        // 定期输出运行指标
+        if (++processedFrames % 10 == 0) {
+            std::ofstream metricsFile("output/metrics.json");
+            metricsFile << Metrics::instance().toJson().toStyledString();
         }
         // 休眠
         // std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
+        overlay.end();
+
+        // 每帧结果都推送到总线, 不受持久化条件限制
+        if (resultBus.subscriberCount() > 0) {
+            resultBus.publish(frameData->imageData.frameID, frameTimeMs, std::make_shared<const Json::Value>(std::move(root)));
+        }
+
+        if (bench.enabled()) {
+            bench.resultFinished(currentFrameID);
+            bench.chargeCpu("aggregate", aggregateCpuMs);
+        }
+
         // 移除已处理的帧数据
         g_frameData.pop();
         std::cout << "_" << std::flush;
@@ -477,49 +876,216 @@ void resultProcessingThread(rknnPool<PerAttr, cv::Mat, PerAttrResult>& perAttrDe
 }
 
 int main(int argc, char* argv[]) {
-
-    const std::string modelPath = std::filesystem::path(argv[0]).parent_path().string() + "/model/";
-    std::cout << "Current working directory: " << modelPath << std::endl;
-    const std::string modelPathPerDet = modelPath + "perdet.rknn";
-    const std::string modelPathPerAttr = modelPath + "perattr.rknn";
-    const std::string modelPathFallDet = modelPath + "falldet.rknn";
-    const std::string modelPathFireSmokeDet = modelPath + "firesmoke.rknn";
+    g_startTime = std::chrono::steady_clock::now();
 
     // 检查命令行参数数量
     if (argc < 2) {
         std::cerr << "Error: Not enough arguments provided." << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <image_source>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [image_source] [--config <path>] [--heatmap] [--clips] [--bus-socket <path>] [--image-format jpg|webp|png] [--keyframe-interval <seconds>] [--headless] [--storage-quota <MB>] [--retention-days <days>] [--threads <n>] [--bench <report.json>] [--rate <fps>]" << std::endl;
         return 1;
     }
-    //    // 创建数据库实例
-    // DatabaseManager dbManager("date.db");
 
-    signal(SIGINT, signalHandler);
-    // 从命令行参数获取图像源
-    std::string frameSrc = argv[1];
-    rtsp_url = argv[1];
+    // 配置文件先于其它参数加载, 命令行参数覆盖配置中的对应项
+    appConfig.modelDir = std::filesystem::path(argv[0]).parent_path().string() + "/model/";
+    std::cout << "Current working directory: " << appConfig.modelDir << std::endl;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--config" && appConfig.load(argv[i + 1]) != 0) {
+            return 1;
+        }
+    }
+
+    // 从命令行参数获取图像源, 省略时使用配置中的视频源
+    std::string frameSrc;
+    int firstOption = 1;
+    if (argv[1][0] != '-') {
+        frameSrc = argv[1];
+        firstOption = 2;
+    }
+    streamConfig = appConfig.streamFor(frameSrc);
+    if (frameSrc.empty()) {
+        frameSrc = streamConfig.source;
+    }
+    if (frameSrc.empty()) {
+        std::cerr << "Error: No image source given on the command line or in the config." << std::endl;
+        return 1;
+    }
+    rtsp_url = frameSrc;
     std::cout << "Using image source: " << frameSrc << std::endl;
 
-    // 初始化模型池
-    rknnPool<PerDet, cv::Mat, PerDetResult> perDetPool(modelPathPerDet, threadNum, g_frameData);
-    perDetPool.init();
+    // 创建数据库实例
+    dbManager = std::make_unique<DatabaseManager>("data.db");
+    detectionLog = std::make_unique<DetectionLogWriter>("output/detlog");
+    // 检测日志和事件片段按小时分片保存, 与结果文件一起受磁盘配额和保留天数管理
+    detectionLog->setDirectoryProvider([](int64_t timestampMs) { return storageManager.dirFor("detlog", timestampMs); });
+    clipRecorder.setDirectoryProvider([](int64_t timestampMs) { return storageManager.dirFor("clips", timestampMs); });
 
-    rknnPool<PerAttr, cv::Mat, PerAttrResult> perAttrDetPool(modelPathPerAttr, threadNum, g_frameData);
-    perAttrDetPool.init();
+    signal(SIGINT, signalHandler);
+    // 区域只在启动时栅格化一次
+    zoneEngine.build(streamConfig.zones);
+    lineCounter.setLines(streamConfig.lines);
+    dwellTracker.setLoiterThreshold(streamConfig.loiterMs);
+    // 宽限至少覆盖两个采样间隔, 漏检一帧不算离开
+    dwellTracker.setExitGrace(std::max<int64_t>(3000, 2 * static_cast<int64_t>(streamConfig.sampleIntervalMs)));
+    // 队列在任何线程启动之前按配置调整长度
+    g_imageData.setCapacity(appConfig.queueLength);
+    g_frameData.setCapacity(appConfig.queueLength);
+    maxFrameID = appConfig.queueLength + 1;
+    ImageFormat imageFormat = ImageFormat::JPEG;
+    int retentionDays = 30;
+    std::string benchReport;
+    double benchRate = 0.0;
+    for (int i = firstOption; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            // 已在前面加载
+            ++i;
+        } else if (arg == "--heatmap") {
+            heatmapService.start();
+            signal(SIGUSR1, heatmapSignalHandler);
+            std::cout << "Heatmap enabled, send SIGUSR1 to save a snapshot" << std::endl;
+        } else if (arg == "--clips") {
+            clipRecorder.start();
+            std::cout << "Event clips enabled, saving to output/clips" << std::endl;
+        } else if (arg == "--bus-socket" && i + 1 < argc) {
+            busServer = std::make_unique<ResultBusSocketServer>(resultBus, argv[++i]);
+            if (busServer->start() != 0) {
+                busServer.reset();
+            }
+        } else if (arg == "--image-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "png") {
+                imageFormat = ImageFormat::PNG;
+            } else if (format == "webp") {
+                imageFormat = ImageFormat::WEBP;
+            } else if (format != "jpg") {
+                std::cerr << "Unknown image format: " << format << ", using jpg" << std::endl;
+            }
+        } else if (arg == "--keyframe-interval" && i + 1 < argc) {
+            // 0 表示只在状态变化时持久化
+            changeDetector.setKeyframeInterval(std::atoll(argv[++i]) * 1000);
+        } else if (arg == "--storage-quota" && i + 1 < argc) {
+            // 0 表示不限配额
+            storageManager.setQuota(std::strtoull(argv[++i], nullptr, 10) << 20);
+        } else if (arg == "--retention-days" && i + 1 < argc) {
+            retentionDays = std::atoi(argv[++i]);
+            storageManager.setRetentionDays(retentionDays);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            // 每个模型池的实例数, 第一个实例之后的实例共享权重; 覆盖配置中各模型的 instances (perdet 固定为 1)
+            int threads = std::max(1, std::atoi(argv[++i]));
+            for (ModelConfig* model : {&appConfig.perDet, &appConfig.perAttr, &appConfig.fallDet, &appConfig.fireSmokeDet}) {
+                model->instances = threads;
+            }
+        } else if (arg == "--bench" && i + 1 < argc) {
+            // 回放基准测试: 视频结束后写出报告并退出
+            benchReport = argv[++i];
+        } else if (arg == "--rate" && i + 1 < argc) {
+            // 基准测试送帧速率 (帧/秒), 0 表示不限速
+            benchRate = std::atof(argv[++i]);
+        } else if (arg == "--headless") {
+            headlessMode = true;
+            std::cout << "Headless mode, result images are not rendered" << std::endl;
+        }
+    }
+    // 人员检测的实例共用一个跟踪会话, SORT 需要按采集顺序逐帧串行更新, 因此只使用一个实例;
+    // 多个实例会并发更新跟踪状态, 帧也会乱序到达, 轨迹 ID 不可靠
+    if (appConfig.perDet.instances > 1) {
+        std::cerr << "Model perdet: " << appConfig.perDet.instances
+                  << " instances requested, using 1 (tracking needs frames in order); --threads/instances do not apply to perdet"
+                  << std::endl;
+        appConfig.perDet.instances = 1;
+    }
+    // PNG 使用最低压缩等级, 优先保证编码速度
+    imageWriter = std::make_unique<ImageWriter>(2, 8, imageFormat, imageFormat == ImageFormat::PNG ? 1 : 90);
 
-    rknnPool<FallDet, cv::Mat, FallDetResult> fallDetPool(modelPathFallDet, threadNum, g_frameData);
-    fallDetPool.init();
+    // 分钟汇总保留一年, 小时汇总永久保留
+    for (const char* category : {"perdet", "falldet", "firesmokedet", "result", "heatmap", "detlog", "clips"}) {
+        storageManager.addCategory(category);
+    }
+    storageManager.setDatabase(dbManager.get(), retentionDays, 365);
+    storageManager.start();
+
+    // 打印生效的配置 (含命令行覆盖), 便于核对现场调整的参数
+    std::cout << appConfig.summary() << std::endl;
+
+    if (!benchReport.empty()) {
+        Json::Value info;
+        info["source"] = frameSrc;
+#ifdef AIBOX_MOCK_NPU
+        info["backend"] = "mock";
+#else
+        info["backend"] = "rknn";
+#endif
+        info["headless"] = headlessMode;
+        info["queueLength"] = static_cast<Json::UInt64>(appConfig.queueLength);
+        for (const ModelConfig* model : {&appConfig.perDet, &appConfig.perAttr, &appConfig.fallDet, &appConfig.fireSmokeDet}) {
+            Json::Value item;
+            item["file"] = appConfig.modelFile(*model);
+            item["instances"] = model->instances;
+            item["pipelined"] = model->pipelined;
+            info["models"].append(item);
+        }
+        ReplayBench::instance().start(benchReport, benchRate, info);
+        std::cout << "Benchmark mode, rate " << (benchRate > 0 ? std::to_string(benchRate) + " fps" : "unthrottled")
+                  << ", report: " << benchReport << std::endl;
+    }
 
-    rknnPool<FireSmokeDet, cv::Mat, FireSmokeDetResult> fireSmokeDetPool(modelPathFireSmokeDet, threadNum, g_frameData);
-    fireSmokeDetPool.init();
+    // 初始化并预热模型池: 四个模型池并行初始化, 启动耗时取决于最慢的模型而不是所有模型之和
+    rknnPool<PerDet, cv::Mat, PerDetResult> perDetPool(appConfig.modelFile(appConfig.perDet), appConfig.perDet.instances, g_frameData);
+    rknnPool<PerAttr, cv::Mat, PerAttrResult> perAttrDetPool(appConfig.modelFile(appConfig.perAttr), appConfig.perAttr.instances, g_frameData);
+    rknnPool<FallDet, cv::Mat, FallDetResult> fallDetPool(appConfig.modelFile(appConfig.fallDet), appConfig.fallDet.instances, g_frameData);
+    rknnPool<FireSmokeDet, cv::Mat, FireSmokeDetResult> fireSmokeDetPool(appConfig.modelFile(appConfig.fireSmokeDet), appConfig.fireSmokeDet.instances, g_frameData);
+    applyModelConfig(perDetPool, appConfig, appConfig.perDet);
+    applyModelConfig(perAttrDetPool, appConfig, appConfig.perAttr);
+    applyModelConfig(fallDetPool, appConfig, appConfig.fallDet);
+    applyModelConfig(fireSmokeDetPool, appConfig, appConfig.fireSmokeDet);
+
+    auto modelsStart = std::chrono::steady_clock::now();
+    std::vector<std::pair<std::string, std::future<int>>> poolInits;
+    poolInits.emplace_back(perDetPool.modelPath(), std::async(std::launch::async, [&perDetPool] { return initAndWarmup(perDetPool); }));
+    poolInits.emplace_back(perAttrDetPool.modelPath(), std::async(std::launch::async, [&perAttrDetPool] { return initAndWarmup(perAttrDetPool); }));
+    poolInits.emplace_back(fallDetPool.modelPath(), std::async(std::launch::async, [&fallDetPool] { return initAndWarmup(fallDetPool); }));
+    poolInits.emplace_back(fireSmokeDetPool.modelPath(), std::async(std::launch::async, [&fireSmokeDetPool] { return initAndWarmup(fireSmokeDetPool); }));
+    // 等待全部完成后汇总所有失败的模型, 不在第一个错误处中断
+    std::vector<std::string> failedModels;
+    for (auto& poolInit : poolInits) {
+        if (poolInit.second.get() != 0) {
+            failedModels.push_back(poolInit.first);
+        }
+    }
+    std::chrono::duration<double, std::milli> modelsElapsed = std::chrono::steady_clock::now() - modelsStart;
+
+    double sequentialMs = 0;
+    std::ostringstream startupReport;
+    startupReport << "Startup report:\n"
+                  << "  model                  inst   load ms   init ms  query ms  total ms  shared  warm 1st  warm avg\n";
+    appendInitReport(perDetPool, startupReport, sequentialMs);
+    appendInitReport(perAttrDetPool, startupReport, sequentialMs);
+    appendInitReport(fallDetPool, startupReport, sequentialMs);
+    appendInitReport(fireSmokeDetPool, startupReport, sequentialMs);
+    std::chrono::duration<double, std::milli> sinceStart = std::chrono::steady_clock::now() - g_startTime;
+    startupReport << "  models ready in " << modelsElapsed.count() << " ms (sum of instances " << sequentialMs
+                  << " ms), " << sinceStart.count() << " ms after process start";
+    std::cout << startupReport.str() << std::endl;
+    Metrics::instance().set("startup.models_ms", modelsElapsed.count());
+
+    if (!failedModels.empty()) {
+        for (const auto& model : failedModels) {
+            std::cerr << "Failed to initialize model pool: " << model << std::endl;
+        }
+        return 1;
+    }
 
     std::thread captureThread(captureFrames, std::ref(g_flags), frameSrc);
     std::thread inferThread(inferenceThread, std::ref(perDetPool), std::ref(fallDetPool), std::ref(fireSmokeDetPool), std::ref(g_flags));
     std::thread resultThread(resultProcessingThread, std::ref(perAttrDetPool), std::ref(g_flags));
+    std::thread modelReloadThread(reloadThread, std::ref(perDetPool), std::ref(perAttrDetPool), std::ref(fallDetPool),
+                                  std::ref(fireSmokeDetPool), std::ref(g_flags));
+    signal(SIGHUP, reloadSignalHandler);
 
     captureThread.join();
     inferThread.join();
     resultThread.join();
+    modelReloadThread.join();
 
     return 0;
 }
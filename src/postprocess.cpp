@@ -21,11 +21,14 @@
 #include <string.h>
 #include <sys/time.h>
 
+#include <mutex>
 #include <set>
 #include <vector>
 #define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
 
 static char *labels[OBJ_CLASS_NUM];
+static std::mutex labelsMtx;
+static bool labelsLoaded = false;
 
 const int anchor0[6] = {10, 13, 16, 30, 33, 23};
 const int anchor1[6] = {30, 61, 62, 45, 59, 119};
@@ -88,7 +91,10 @@ int readLines(const char *fileName, char *lines[], int max_line)
 int loadLabelName(const char *locationFilename, char *label[])
 {
     printf("loadLabelName %s\n", locationFilename);
-    readLines(locationFilename, label, OBJ_CLASS_NUM);
+    // 文件不存在时返回失败, 否则 post_process 会访问空标签
+    if (readLines(locationFilename, label, OBJ_CLASS_NUM) < 0) {
+        return -1;
+    }
     return 0;
 }
 
@@ -236,16 +242,10 @@ static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int heigh
 int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
                  float nms_threshold, BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
                  std::vector<float> &qnt_scales, detect_result_group_t *group) {
-    static int init = -1;
-    if (init == -1) {
-    int ret = 0;
-    ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
-    if (ret < 0) {
+    // 正常流程中标签已在模型初始化时加载, 这里只是兜底
+    if (initPostProcess() < 0) {
         return -1;
     }
-
-    init = 0;
-    }
     memset(group, 0, sizeof(detect_result_group_t));
 
     std::vector<float> filterBoxes;
@@ -329,8 +329,24 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
     return 0;
 }
 
+int initPostProcess(const char *labelsPath)
+{
+    std::lock_guard<std::mutex> lock(labelsMtx);
+    if (labelsLoaded) {
+        return 0;
+    }
+    int ret = loadLabelName(labelsPath != nullptr ? labelsPath : LABEL_NALE_TXT_PATH, labels);
+    if (ret < 0) {
+        return -1;
+    }
+    labelsLoaded = true;
+    return 0;
+}
+
 void deinitPostProcess()
 {
+    std::lock_guard<std::mutex> lock(labelsMtx);
+    labelsLoaded = false;
     for (int i = 0; i < OBJ_CLASS_NUM; i++) {
     if (labels[i] != nullptr) {
         free(labels[i]);
@@ -40,6 +40,11 @@ void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, cons
 
 int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size)
 {
+#ifdef AIBOX_MOCK_NPU
+    // 模拟后端不链接 librga, 用 OpenCV 缩放
+    cv::resize(image, resized_image, target_size);
+    return 0;
+#else
     im_rect src_rect;
     im_rect dst_rect;
     memset(&src_rect, 0, sizeof(src_rect));
@@ -61,4 +66,5 @@ int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::M
     }
     IM_STATUS STATUS = imresize(src, dst);
     return 0;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+// 检测日志查询工具
+// 用法:
+//   detlog <目录> info                               列出段文件
+//   detlog <目录> time <开始毫秒> <结束毫秒> [-c]     按时间范围输出记录, -c 只统计数量
+//   detlog <目录> frames <开始序号> <结束序号> [-c]   按采集序号范围输出记录 (帧ID循环使用, 不用于查询)
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include "DetectionLog.h"
+
+namespace {
+
+const char* modelName(uint8_t model) {
+    switch (static_cast<DetLogModel>(model)) {
+    case DetLogModel::Person: return "person";
+    case DetLogModel::Fall: return "fall";
+    case DetLogModel::FireSmoke: return "firesmoke";
+    }
+    return "unknown";
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <log_dir> info" << std::endl;
+    std::cerr << "       " << prog << " <log_dir> time <begin_ms> <end_ms> [-c]" << std::endl;
+    std::cerr << "       " << prog << " <log_dir> frames <begin_sequence> <end_sequence> [-c]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    DetectionLogReader reader(argv[1]);
+    if (reader.open() != 0) {
+        return 1;
+    }
+
+    std::string cmd = argv[2];
+    if (cmd == "info") {
+        for (const auto& segment : reader.segments()) {
+            const DetLogSegmentHeader& header = segment.header;
+            std::cout << segment.path << " records=" << header.recordCount
+                      << " time=[" << header.firstTimestampMs << ", " << header.lastTimestampMs << "]"
+                      << " sequence=[" << header.firstSequence << ", " << header.lastSequence << "]" << std::endl;
+        }
+        return 0;
+    }
+
+    if ((cmd != "time" && cmd != "frames") || argc < 5) {
+        usage(argv[0]);
+        return 1;
+    }
+    bool countOnly = argc > 5 && std::strcmp(argv[5], "-c") == 0;
+
+    // 只统计时按模型分类计数, 否则输出 CSV
+    std::map<std::string, uint64_t> counts;
+    auto onRecord = [countOnly, &counts](const DetLogRecord& r) {
+        if (countOnly) {
+            counts[modelName(r.model)]++;
+        } else {
+            std::cout << r.timestampMs << ',' << r.sequence << ',' << r.frameID << ',' << modelName(r.model) << ','
+                      << static_cast<int>(r.classId) << ',' << r.trackId << ',' << r.confidence << ','
+                      << r.x << ',' << r.y << ',' << r.width << ',' << r.height << '\n';
+        }
+        return true;
+    };
+
+    if (!countOnly) {
+        std::cout << "timestamp_ms,sequence,frame_id,model,class_id,track_id,confidence,x,y,width,height\n";
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total;
+    if (cmd == "time") {
+        total = reader.scanTime(std::atoll(argv[3]), std::atoll(argv[4]), onRecord);
+    } else {
+        total = reader.scanSequence(std::strtoull(argv[3], nullptr, 10), std::strtoull(argv[4], nullptr, 10), onRecord);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (countOnly) {
+        for (const auto& item : counts) {
+            std::cout << item.first << ": " << item.second << std::endl;
+        }
+        std::cout << "total: " << total << " records in " << elapsed.count() << " ms" << std::endl;
+    }
+    return 0;
+}